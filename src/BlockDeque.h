@@ -0,0 +1,304 @@
+/**
+ * @file BlockDeque.h
+ *
+ * A double-ended queue stored in fixed-size blocks. Similar to std::deque
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_BLOCK_DEQUE_H
+#define EDA_BLOCK_DEQUE_H
+
+#include "Util.h"
+
+DECLARE_EXCEPTION(BlockDequeInvalidIndex)
+
+/**
+ * A double-ended queue that stores its elements in fixed-size blocks,
+ * and keeps pointers to those blocks in a 'map'. Random access is O(1)
+ * (one extra indirection compared to a CVector), and so are insertion and
+ * removal at both ends.
+ *
+ * Unlike a CVector, it never copies its elements when growing: only the
+ * (much smaller) map of block pointers is ever reallocated. Therefore,
+ * references to elements remain valid across pushes and pops at either end
+ * (as long as they do not refer to popped elements), and memory grows one
+ * block at a time. A block that empties out is kept as a spare, to be
+ * reused by the next block allocation, so that a deque that oscillates
+ * around a block boundary does not keep allocating and freeing blocks.
+ *
+ * Can be used as the container of a Deque or a Queue.
+ *
+ * @author mfreire
+ */
+template <class Type, uint BLOCK_SIZE = 256>
+class BlockDeque {
+
+    /// initial number of slots in the map
+    static const uint INITIAL_MAP_SIZE = 8;
+
+    Type** _map;     ///< block pointers; 0 for slots not in use
+    uint _mapSize;   ///< number of slots in _map
+    uint _first;     ///< position of first element, counting from _map[0]
+    uint _used;      ///< number of elements
+    Type* _spare;    ///< an empty block, ready for reuse; 0 if none
+
+public:
+
+    /**  */
+    BlockDeque() {
+        _init();
+    }
+
+    /**  */
+    BlockDeque(const BlockDeque& other) {
+        _init();
+        for (uint i=0; i<other._used; i++) {
+            push_back(other.at(i));
+        }
+    }
+
+    /**  */
+    ~BlockDeque() {
+        _clear();
+    }
+
+    /** */
+    BlockDeque& operator=(const BlockDeque& other) {
+        if (&other != this) {
+            _clear();
+            _init();
+            for (uint i=0; i<other._used; i++) {
+                push_back(other.at(i));
+            }
+        }
+        return (*this);
+    }
+
+    /**  */
+    uint size() const {
+        return _used;
+    }
+
+    class Iterator {
+    public:
+        void next() {
+            _pos ++;
+        }
+
+        const Type& elem() const {
+            if (_pos >= _d->_used) {
+                throw BlockDequeInvalidIndex("elem");
+            }
+            return _d->at(_pos);
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _pos == other._pos;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _pos != other._pos;
+        }
+    protected:
+        friend class BlockDeque;
+
+        const BlockDeque* _d;
+
+        uint _pos;
+
+        Iterator(const BlockDeque *d, uint pos)
+            : _d(d), _pos(pos) {}
+    };
+
+    /** */
+    Iterator begin() const {
+        return Iterator(this, 0);
+    }
+
+    /** */
+    const Iterator end() const {
+        return Iterator(this, _used);
+    }
+
+    /** */
+    const Type& at(uint pos) const {
+        if (pos >= _used) {
+            throw BlockDequeInvalidIndex("at");
+        }
+        return _slot(_first + pos);
+    }
+
+    /** */
+    Type& at(uint pos) {
+        if (pos >= _used) {
+            throw BlockDequeInvalidIndex("at");
+        }
+        return _slot(_first + pos);
+    }
+
+    /** */
+    void push_back(const Type& e) {
+        if (_first + _used == _mapSize * BLOCK_SIZE) {
+            _remap();
+        }
+        uint p = _first + _used;
+        if (_used == 0 || p % BLOCK_SIZE == 0) {
+            _map[p / BLOCK_SIZE] = _newBlock();
+        }
+        _slot(p) = e;
+        _used ++;
+    }
+
+    /** */
+    const Type& back() const {
+        if (_used == 0) {
+            throw BlockDequeInvalidIndex("back");
+        }
+        return _slot(_first + _used - 1);
+    }
+
+    /** */
+    Type& back() {
+        if (_used == 0) {
+            throw BlockDequeInvalidIndex("back");
+        }
+        return _slot(_first + _used - 1);
+    }
+
+    /**  */
+    void pop_back() {
+        if (_used == 0) {
+            throw BlockDequeInvalidIndex("pop_back");
+        }
+        uint p = _first + _used - 1;
+        _used --;
+        if (_used == 0 || p % BLOCK_SIZE == 0) {
+            _releaseBlock(p / BLOCK_SIZE);
+        }
+        if (_used == 0) {
+            _first = _center();
+        }
+    }
+
+    /**  */
+    void push_front(const Type& e) {
+        if (_first == 0) {
+            _remap();
+        }
+        uint p = _first - 1;
+        if (_used == 0 || p % BLOCK_SIZE == BLOCK_SIZE - 1) {
+            _map[p / BLOCK_SIZE] = _newBlock();
+        }
+        _slot(p) = e;
+        _first = p;
+        _used ++;
+    }
+
+    /**  */
+    const Type& front() const {
+        if (_used == 0) {
+            throw BlockDequeInvalidIndex("front");
+        }
+        return _slot(_first);
+    }
+
+    /**  */
+    Type& front() {
+        if (_used == 0) {
+            throw BlockDequeInvalidIndex("front");
+        }
+        return _slot(_first);
+    }
+
+    /**  */
+    void pop_front() {
+        if (_used == 0) {
+            throw BlockDequeInvalidIndex("pop_front");
+        }
+        uint p = _first;
+        _first ++;
+        _used --;
+        if (_used == 0 || _first % BLOCK_SIZE == 0) {
+            _releaseBlock(p / BLOCK_SIZE);
+        }
+        if (_used == 0) {
+            _first = _center();
+        }
+    }
+
+private:
+
+    void _init() {
+        _mapSize = INITIAL_MAP_SIZE;
+        _map = new Type*[_mapSize]();
+        _used = 0;
+        _first = _center();
+        _spare = 0;
+    }
+
+    void _clear() {
+        for (uint i=0; i<_mapSize; i++) {
+            delete[] _map[i];
+        }
+        delete[] _map;
+        delete[] _spare;
+        _map = 0;
+        _spare = 0;
+    }
+
+    uint _center() const {
+        return (_mapSize / 2) * BLOCK_SIZE;
+    }
+
+    Type& _slot(uint p) const {
+        return _map[p / BLOCK_SIZE][p % BLOCK_SIZE];
+    }
+
+    Type* _newBlock() {
+        Type* block = _spare;
+        if (block) {
+            _spare = 0;
+        } else {
+            block = new Type[BLOCK_SIZE];
+        }
+        return block;
+    }
+
+    void _releaseBlock(uint slot) {
+        if (_spare) {
+            delete[] _map[slot];
+        } else {
+            _spare = _map[slot];
+        }
+        _map[slot] = 0;
+    }
+
+    /**
+     * Re-centers blocks in the map, so that there are free slots at both
+     * ends; the map is doubled if more than half full. Only block pointers
+     * are moved. Amortized O(1) per push.
+     */
+    void _remap() {
+        uint firstSlot = _first / BLOCK_SIZE;
+        uint slots = _used ? (_first + _used - 1) / BLOCK_SIZE - firstSlot + 1 : 0;
+        uint size = (slots * 2 + 2 > _mapSize) ? _mapSize * 2 : _mapSize;
+        Type** map = new Type*[size]();
+        uint newFirstSlot = (size - slots) / 2;
+        for (uint i=0; i<slots; i++) {
+            map[newFirstSlot + i] = _map[firstSlot + i];
+        }
+        delete[] _map;
+        _map = map;
+        _mapSize = size;
+        _first = newFirstSlot * BLOCK_SIZE + _first % BLOCK_SIZE;
+    }
+};
+
+#endif // EDA_BLOCK_DEQUE_H
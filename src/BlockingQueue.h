@@ -0,0 +1,227 @@
+/**
+ * @file BlockingQueue.h
+ *
+ * A bounded queue whose operations wait until they can be completed.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_BLOCKING_QUEUE_H
+#define EDA_BLOCKING_QUEUE_H
+
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "Util.h"
+#include "CVector.h"
+
+DECLARE_EXCEPTION(BlockingQueueInvalidCapacity)
+
+/**
+ * A fixed-capacity first-in, first-out queue for passing elements between
+ * threads, such as the stages of a pipeline. A push into a full queue waits
+ * until a consumer makes room, so fast producers are slowed down to the
+ * pace of their consumers (backpressure) instead of making the queue grow.
+ * A pop from an empty queue waits until a producer pushes something.
+ *
+ * Closing the queue wakes up all waiting threads: from then on, pushes
+ * fail, and pops fail as soon as the queue is empty.
+ *
+ * Built on a CVector guarded by a mutex; waiting threads sleep on
+ * condition variables, which are only signalled if someone is waiting.
+ *
+ * @author mfreire
+ */
+template <class Type>
+class BlockingQueue {
+
+    CVector<Type> _v;       ///< elements in queue
+    uint _max;              ///< maximum number of elements
+    bool _closed;           ///< if true, no more elements will be pushed
+    uint _waitingPushes;    ///< threads waiting for room
+    uint _waitingPops;      ///< threads waiting for elements
+
+    mutable std::mutex _m;           ///< guards all of the above
+    std::condition_variable _notFull;  ///< signalled on pop and close
+    std::condition_variable _notEmpty; ///< signalled on push and close
+
+    typedef std::unique_lock<std::mutex> Lock;
+
+public:
+
+    /**  */
+    BlockingQueue(uint capacity)
+        : _max(capacity), _closed(false), _waitingPushes(0), _waitingPops(0) {
+        if (capacity == 0) {
+            throw BlockingQueueInvalidCapacity("BlockingQueue");
+        }
+    }
+
+    /**  */
+    uint capacity() const {
+        return _max;
+    }
+
+    /**  */
+    uint size() const {
+        Lock lock(_m);
+        return _v.size();
+    }
+
+    /**
+     * Pushes e, waiting for room if the queue is full.
+     * @return false if the queue was (or became) closed
+     */
+    bool push(const Type& e) {
+        Lock lock(_m);
+        while (_v.size() == _max && ! _closed) {
+            _waitingPushes ++;
+            _notFull.wait(lock);
+            _waitingPushes --;
+        }
+        return _push(e, lock);
+    }
+
+    /**
+     * Pushes e, waiting for at most 'timeout' for room if the queue is full.
+     * @return false if it timed out, or the queue was (or became) closed
+     */
+    template <class Rep, class Period>
+    bool push_for(const Type& e,
+                  const std::chrono::duration<Rep, Period>& timeout) {
+        Lock lock(_m);
+        std::chrono::steady_clock::time_point limit =
+            std::chrono::steady_clock::now() + timeout;
+        while (_v.size() == _max && ! _closed) {
+            _waitingPushes ++;
+            std::cv_status status = _notFull.wait_until(lock, limit);
+            _waitingPushes --;
+            if (status == std::cv_status::timeout && _v.size() == _max) {
+                return false;
+            }
+        }
+        return _push(e, lock);
+    }
+
+    /**
+     * Pops the first element into e, waiting for one if the queue is empty.
+     * @return false if the queue was (or became) closed and is empty
+     */
+    bool pop(Type& e) {
+        Lock lock(_m);
+        while (_v.size() == 0 && ! _closed) {
+            _waitingPops ++;
+            _notEmpty.wait(lock);
+            _waitingPops --;
+        }
+        return _pop(e, lock);
+    }
+
+    /**
+     * Pops the first element into e, waiting for at most 'timeout'
+     * for one if the queue is empty.
+     * @return false if it timed out, or the queue was (or became) closed
+     * and is empty
+     */
+    template <class Rep, class Period>
+    bool pop_for(Type& e, const std::chrono::duration<Rep, Period>& timeout) {
+        Lock lock(_m);
+        std::chrono::steady_clock::time_point limit =
+            std::chrono::steady_clock::now() + timeout;
+        while (_v.size() == 0 && ! _closed) {
+            _waitingPops ++;
+            std::cv_status status = _notEmpty.wait_until(lock, limit);
+            _waitingPops --;
+            if (status == std::cv_status::timeout && _v.size() == 0) {
+                return false;
+            }
+        }
+        return _pop(e, lock);
+    }
+
+    /**
+     * Waits until the queue is not empty, and then pops up to n elements
+     * at once, appending them to 'out' via push_back. Amortizes
+     * locking and wake-ups over the whole batch.
+     * @return number of elements popped; 0 only if the queue was (or became)
+     * closed and is empty
+     */
+    template <class Container>
+    uint pop_up_to(Container& out, uint n) {
+        Lock lock(_m);
+        while (_v.size() == 0 && ! _closed) {
+            _waitingPops ++;
+            _notEmpty.wait(lock);
+            _waitingPops --;
+        }
+        uint count = 0;
+        while (count < n && _v.size()) {
+            out.push_back(_v.front());
+            _v.pop_front();
+            count ++;
+        }
+        if (count && _waitingPushes) {
+            if (count == 1) {
+                _notFull.notify_one();
+            } else {
+                _notFull.notify_all();
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Closes the queue, waking up all waiting threads. Elements already
+     * in the queue can still be popped.
+     */
+    void close() {
+        Lock lock(_m);
+        _closed = true;
+        _notFull.notify_all();
+        _notEmpty.notify_all();
+    }
+
+    /**  */
+    bool closed() const {
+        Lock lock(_m);
+        return _closed;
+    }
+
+private:
+
+    // queues are shared by reference; copying one makes no sense
+    BlockingQueue(const BlockingQueue&);
+    BlockingQueue& operator=(const BlockingQueue&);
+
+    bool _push(const Type& e, Lock&) {
+        if (_closed) {
+            return false;
+        }
+        _v.push_back(e);
+        if (_waitingPops) {
+            _notEmpty.notify_one();
+        }
+        return true;
+    }
+
+    bool _pop(Type& e, Lock&) {
+        if (_v.size() == 0) {
+            return false;
+        }
+        e = _v.front();
+        _v.pop_front();
+        if (_waitingPushes) {
+            _notFull.notify_one();
+        }
+        return true;
+    }
+};
+
+#endif // EDA_BLOCKING_QUEUE_H
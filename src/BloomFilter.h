@@ -0,0 +1,494 @@
+/**
+ * @file BloomFilter.h
+ *
+ * Bloom filters: compact sets that can only tell keys that are definitely
+ * absent from keys that may be present.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_BLOOM_FILTER_H
+#define EDA_BLOOM_FILTER_H
+
+#include <cmath>
+#include <cstring>
+
+#include "Hash.h"
+#include "Util.h"
+
+/**
+ * Number of hashes that minimizes false positives for a number of bits
+ * per key: bitsPerKey * ln 2, between 1 and 16
+ */
+inline uint bloom_hashes(double bitsPerKey) {
+    int k = (int)(bitsPerKey * 0.6931 + 0.5);
+    return (k < 1) ? 1 : (k > 16) ? 16 : k;
+}
+
+/**
+ * A Bloom filter (B. H. Bloom, 1970): remembers inserted keys as a few
+ * bits set in a bit array, so that lookups never miss an inserted key,
+ * but may also (with a small, configurable probability) report keys that
+ * were never inserted. Use it to avoid costlier lookups for keys that are
+ * definitely absent. Keys cannot be removed.
+ *
+ * Each key sets k bits, at positions derived from its 64-bit hash() by
+ * double hashing (A. Kirsch and M. Mitzenmacher, 2006), so keys are only
+ * hashed once. With b bits per key and the best k (around 0.7 b), around
+ * 0.62^b of all lookups of absent keys are false positives: 0.8% for
+ * b = 10, and 0.05% for b = 16. Lookups of present keys touch k
+ * different cache lines; those of absent keys stop at the first clear
+ * bit, usually after 1 or 2, as about half the bits are clear. See
+ * BlockedBloomFilter for one cache line per key.
+ *
+ * @author mfreire
+ */
+template <class KeyType>
+class BloomFilter {
+
+    uint64_t* _words;   ///< the bit array
+    ulong _bits;        ///< number of bits
+    uint _hashes;       ///< bits set per key
+    ulong _size;        ///< keys inserted
+
+public:
+
+    /**
+     * @param expectedKeys number of keys that will be inserted
+     * @param bitsPerKey bits of memory per key: more means fewer false
+     *   positives, but also more bits to check per lookup
+     */
+    explicit BloomFilter(ulong expectedKeys, double bitsPerKey = 10)
+            : _hashes(bloom_hashes(bitsPerKey)), _size(0) {
+        _bits = (ulong)(expectedKeys * bitsPerKey);
+        _bits = (_bits < 64) ? 64 : (_bits + 63) / 64 * 64;
+        _words = new uint64_t[_bits / 64];
+        clear();
+    }
+
+    /** */
+    BloomFilter(const BloomFilter& other)
+            : _words(new uint64_t[other._bits / 64]), _bits(other._bits),
+              _hashes(other._hashes), _size(other._size) {
+        memcpy(_words, other._words, _bits / 8);
+    }
+
+    /** */
+    BloomFilter& operator=(const BloomFilter& other) {
+        if (this != &other) {
+            uint64_t* words = new uint64_t[other._bits / 64];
+            memcpy(words, other._words, other._bits / 8);
+            delete[] _words;
+            _words = words;
+            _bits = other._bits;
+            _hashes = other._hashes;
+            _size = other._size;
+        }
+        return *this;
+    }
+
+    /** */
+    ~BloomFilter() {
+        delete[] _words;
+    }
+
+    /** */
+    void insert(const KeyType& key) {
+        uint64_t h = hash(key);
+        uint64_t delta = _delta(h);
+        for (uint i=0; i<_hashes; i++, h+=delta) {
+            ulong bit = _reduce(h);
+            _words[bit / 64] |= 1ULL << (bit % 64);
+        }
+        _size ++;
+    }
+
+    /** @return false if key was definitely never inserted */
+    bool mayContain(const KeyType& key) const {
+        return _mayContain(key);
+    }
+
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, bool>::type
+    mayContain(const Other& key) const {
+        return _mayContain(key);
+    }
+
+    /** forgets all keys */
+    void clear() {
+        memset(_words, 0, _bits / 8);
+        _size = 0;
+    }
+
+    /** @return number of insertions since built or cleared */
+    ulong size() const {
+        return _size;
+    }
+
+    /** @return size of the bit array */
+    ulong bits() const {
+        return _bits;
+    }
+
+    /** @return bits set (and checked) per key */
+    uint hashes() const {
+        return _hashes;
+    }
+
+    /** @return approximate memory used, in bytes */
+    ulong bytes() const {
+        return sizeof(*this) + _bits / 8;
+    }
+
+    /**
+     * @return expected fraction of lookups of absent keys that return
+     * true, given the keys inserted so far
+     */
+    double falsePositiveRate() const {
+        double unset = std::exp(-(double)_hashes * _size / _bits);
+        return std::pow(1 - unset, (double)_hashes);
+    }
+
+private:
+
+    /** @return x scaled from [0, 2^64) to [0, _bits) */
+    ulong _reduce(uint64_t x) const {
+        uint64_t lo, hi;
+        hash_mul128(x, _bits, lo, hi);
+        return hi;
+    }
+
+    /** @return step between the positions of a key with hash h; odd */
+    static uint64_t _delta(uint64_t h) {
+        return ((h >> 32) | (h << 32)) | 1;
+    }
+
+    template <class Key>
+    bool _mayContain(const Key& key) const {
+        uint64_t h = hash(key);
+        uint64_t delta = _delta(h);
+        for (uint i=0; i<_hashes; i++, h+=delta) {
+            ulong bit = _reduce(h);
+            if ( ! (_words[bit / 64] & (1ULL << (bit % 64)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * A Bloom filter that keeps all the bits of each key within a single
+ * block of 512 bits (a cache line): every lookup touches one cache line,
+ * instead of one per bit, at the price of somewhat more false positives
+ * for the same memory (around 1% instead of 0.8% with 10 bits per key),
+ * as blocks do not all get the same number of keys. Pays off once the
+ * filter no longer fits in cache. Bits of a key are spread over
+ * consecutive words of its block, one per word for the first 8 (after
+ * F. Putze, P. Sanders and J. Singler, 2007; and the "split block"
+ * filters of Apache Impala). Same interface as a BloomFilter.
+ *
+ * @author mfreire
+ */
+template <class KeyType>
+class BlockedBloomFilter {
+
+    /** 64-bit words per block */
+    static const uint WORDS = EDA_CACHE_LINE / 8;
+
+    uint64_t* _memory;  ///< as allocated
+    uint64_t* _words;   ///< the blocks, aligned to a cache line
+    ulong _blocks;      ///< number of blocks
+    uint _hashes;       ///< bits set per key
+    ulong _size;        ///< keys inserted
+
+public:
+
+    /**
+     * @param expectedKeys number of keys that will be inserted
+     * @param bitsPerKey bits of memory per key: more means fewer false
+     *   positives
+     */
+    explicit BlockedBloomFilter(ulong expectedKeys, double bitsPerKey = 10)
+            : _hashes(bloom_hashes(bitsPerKey)), _size(0) {
+        _blocks = (ulong)(expectedKeys * bitsPerKey) / (WORDS * 64) + 1;
+        _allocate();
+        clear();
+    }
+
+    /** */
+    BlockedBloomFilter(const BlockedBloomFilter& other)
+            : _blocks(other._blocks), _hashes(other._hashes),
+              _size(other._size) {
+        _allocate();
+        memcpy(_words, other._words, _blocks * WORDS * 8);
+    }
+
+    /** */
+    BlockedBloomFilter& operator=(const BlockedBloomFilter& other) {
+        if (this != &other) {
+            uint64_t* memory = new uint64_t[(other._blocks + 1) * WORDS];
+            uint64_t* words = _aligned(memory);
+            memcpy(words, other._words, other._blocks * WORDS * 8);
+            delete[] _memory;
+            _memory = memory;
+            _words = words;
+            _blocks = other._blocks;
+            _hashes = other._hashes;
+            _size = other._size;
+        }
+        return *this;
+    }
+
+    /** */
+    ~BlockedBloomFilter() {
+        delete[] _memory;
+    }
+
+    /** */
+    void insert(const KeyType& key) {
+        uint64_t h = hash(key);
+        uint64_t* block = _blockFor(h);
+        uint64_t g = hash_int(h);
+        uint first = _firstWord(g);
+        for (uint i=0; i<_hashes; i++) {
+            block[(first + i) % WORDS] |= 1ULL << _bitFor(g, i);
+        }
+        _size ++;
+    }
+
+    /** @return false if key was definitely never inserted */
+    bool mayContain(const KeyType& key) const {
+        return _mayContain(key);
+    }
+
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, bool>::type
+    mayContain(const Other& key) const {
+        return _mayContain(key);
+    }
+
+    /** forgets all keys */
+    void clear() {
+        memset(_words, 0, _blocks * WORDS * 8);
+        _size = 0;
+    }
+
+    /** @return number of insertions since built or cleared */
+    ulong size() const {
+        return _size;
+    }
+
+    /** @return size of the bit array */
+    ulong bits() const {
+        return _blocks * WORDS * 64;
+    }
+
+    /** @return bits set (and checked) per key */
+    uint hashes() const {
+        return _hashes;
+    }
+
+    /** @return approximate memory used, in bytes */
+    ulong bytes() const {
+        return sizeof(*this) + (_blocks + 1) * WORDS * 8;
+    }
+
+    /**
+     * @return expected fraction of lookups of absent keys that return
+     * true, given the keys inserted so far; as for a BloomFilter, and
+     * therefore somewhat optimistic
+     */
+    double falsePositiveRate() const {
+        double unset = std::exp(-(double)_hashes * _size / bits());
+        return std::pow(1 - unset, (double)_hashes);
+    }
+
+private:
+
+    /** allocates _blocks blocks, aligned to a cache line */
+    void _allocate() {
+        _memory = new uint64_t[(_blocks + 1) * WORDS];
+        _words = _aligned(_memory);
+    }
+
+    /** @return the first cache line boundary within memory */
+    static uint64_t* _aligned(uint64_t* memory) {
+        ulong misalignment = (ulong)memory % EDA_CACHE_LINE;
+        return misalignment ?
+            memory + (EDA_CACHE_LINE - misalignment) / 8 : memory;
+    }
+
+    uint64_t* _blockFor(uint64_t h) const {
+        uint64_t lo, hi;
+        hash_mul128(h, _blocks, lo, hi);
+        return _words + hi * WORDS;
+    }
+
+    /**
+     * @return word (within its block) for the first hash of a key;
+     * with fewer than 8 hashes, keys must not all skip the same words
+     */
+    static uint _firstWord(uint64_t g) {
+        return g >> 61;
+    }
+
+    /** @return bit (within its word) for the i-th hash of a key */
+    static uint _bitFor(uint64_t& g, uint i) {
+        // 6 of the lowest 60 bits per hash, so each g serves 10 hashes
+        if (i % 10 == 0 && i > 0) {
+            g = hash_int(g);
+        }
+        return (g >> (6 * (i % 10))) & 63;
+    }
+
+    template <class Key>
+    bool _mayContain(const Key& key) const {
+        uint64_t h = hash(key);
+        const uint64_t* block = _blockFor(h);
+        uint64_t g = hash_int(h);
+        uint first = _firstWord(g);
+        // all bits are in the same cache line, so checking them all costs
+        // less than mispredicting when to stop
+        uint64_t all = 1;
+        for (uint i=0; i<_hashes; i++) {
+            all &= block[(first + i) % WORDS] >> _bitFor(g, i);
+        }
+        return all;
+    }
+};
+
+/**
+ * A set or map (such as a Set::H, or a Map::T) with a Bloom filter in
+ * front: lookups of keys that the filter rules out return false without
+ * looking at the container at all, which pays off when most lookups are
+ * misses. Inserted keys go into both; erased ones only leave the
+ * container, as filters cannot forget keys, and so make the filter a
+ * little less effective until rebuild(). The filter is rebuilt, with
+ * twice the capacity, whenever the container outgrows it.
+ * Containers must only be changed through this class.
+ *
+ * contains() counts the lookups that the filter answers (see filtered()),
+ * and so writes even though it is const: unlike a plain Set or Map, a
+ * shared BloomFiltered cannot be looked up from several threads at once
+ * without locking.
+ *
+ * @author mfreire
+ */
+template <class KeyType, class Container,
+          class Filter = BlockedBloomFilter<KeyType> >
+class BloomFiltered {
+
+    Container _c;              ///< the actual keys (and values)
+    Filter _filter;            ///< has all keys in _c, and maybe others
+    ulong _capacity;           ///< keys that _filter was sized for
+    double _bitsPerKey;        ///< of _filter, when sized for _capacity
+    mutable ulong _filtered;   ///< lookups answered by the filter alone
+
+public:
+
+    /** */
+    typedef typename Container::Iterator Iterator;
+
+    /**
+     * @param expectedKeys initial capacity of the filter
+     * @param bitsPerKey bits of filter per key
+     */
+    explicit BloomFiltered(ulong expectedKeys = 1024, double bitsPerKey = 10)
+            : _filter(expectedKeys, bitsPerKey), _capacity(expectedKeys),
+              _bitsPerKey(bitsPerKey), _filtered(0) {}
+
+    /** */
+    Iterator begin() const {
+        return _c.begin();
+    }
+
+    /** */
+    Iterator end() const {
+        return _c.end();
+    }
+
+    /** */
+    bool contains(const KeyType& key) const {
+        if ( ! _filter.mayContain(key)) {
+            _filtered ++;
+            return false;
+        }
+        return _c.contains(key);
+    }
+
+    /** inserts a key into a set */
+    void insert(const KeyType& key) {
+        _c.insert(key);
+        _inserted(key);
+    }
+
+    /** inserts a key and its value into a map */
+    template <class ValueType>
+    void insert(const KeyType& key, const ValueType& value) {
+        _c.insert(key, value);
+        _inserted(key);
+    }
+
+    /** */
+    void erase(const KeyType& key) {
+        _c.erase(key);
+    }
+
+    /** */
+    uint size() const {
+        return _c.size();
+    }
+
+    /** for lookups (such as at()) other than contains() */
+    const Container& container() const {
+        return _c;
+    }
+
+    /** */
+    const Filter& filter() const {
+        return _filter;
+    }
+
+    /**
+     * @return lookups that the filter answered, without the container;
+     * not thread-safe, even for const lookups
+     */
+    ulong filtered() const {
+        return _filtered;
+    }
+
+    /** rebuilds the filter from the keys in the container */
+    void rebuild() {
+        _rebuild(_capacity);
+    }
+
+private:
+
+    void _inserted(const KeyType& key) {
+        if (_c.size() > _capacity) {
+            _rebuild(2 * _c.size());
+        } else {
+            _filter.insert(key);
+        }
+    }
+
+    void _rebuild(ulong capacity) {
+        Filter filter(capacity, _bitsPerKey);
+        for (Iterator it = _c.begin(); it != _c.end(); it.next()) {
+            filter.insert(it.key());
+        }
+        _filter = filter;
+        _capacity = capacity;
+    }
+};
+
+#endif // EDA_BLOOM_FILTER_H
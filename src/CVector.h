@@ -16,15 +16,27 @@
 #define EDA_CVECTOR_H
 
 #include <iomanip>
+#include <climits>
 
 #include "Util.h"
 
 DECLARE_EXCEPTION(CVectorInvalidIndex)
+DECLARE_EXCEPTION(CVectorInvalidCapacity)
+
+/** selects the fixed-capacity constructor of a CVector */
+enum FixedCapacity { FIXED_CAPACITY };
 
 /**
  * A circular vector, also called a circular buffer.
  * Random access, slightly slower than for a normal vector.
  * Efficient insertion and removal at both ends.
+ *
+ * A CVector built with a fixed capacity, as in
+ * <code>CVector<int> last(100, FIXED_CAPACITY)</code>, never grows (and
+ * never allocates after construction): pushing into a full one
+ * overwrites the element at the opposite end. This keeps the last N
+ * elements pushed, as in a sliding window; segments() exposes them as (at
+ * most) two contiguous runs, for fast aggregation.
  * 
  * @author mfreire
  */
@@ -39,18 +51,32 @@ class CVector {
     uint _end;   ///< index of first free slot after start
     uint _used;  ///< number of slots used
     uint _max;   ///< total number of slots in _v
+    bool _fixed; ///< if true, never grows; overwrites when full
     
 public:
     
     /**  */
-    CVector() : _start(0), _end(0), _used(0), _max(INITIAL_SIZE) {
+    CVector() : _start(0), _end(0), _used(0), _max(INITIAL_SIZE), _fixed(false) {
+        _v = new Type[_max];
+    }
+
+    /**
+     * Builds a fixed-capacity vector, which will never grow: when full,
+     * push_back overwrites the front, and push_front overwrites the back.
+     * @param capacity at most UINT_MAX - 1
+     */
+    CVector(uint capacity, FixedCapacity) : _start(0), _end(0), _used(0),
+        _max(capacity + 1), _fixed(true) {
+        if (capacity == UINT_MAX) {
+            throw CVectorInvalidCapacity("too large");
+        }
         _v = new Type[_max];
     }
     
     /**  */
     CVector(const CVector& other) :
         _start(other._start), _end(other._end),
-        _used(other._used), _max(other._max) {
+        _used(other._used), _max(other._max), _fixed(other._fixed) {
             
         _v = new Type[other._max];
         for (uint i=0; i<_max; i++) {
@@ -66,15 +92,18 @@ public:
 
     /** */
     CVector& operator=(const CVector& other) {
-        delete _v;
-        _max = other._max;
-        _v = new Type[_max];
-        _used = other.size();
-        for (uint i=other._start, j=0; i!=other._end; i=other._inc(i)) {
-            _v[j++] = other._v[i];
+        if (&other != this) {
+            delete[] _v;
+            _max = other._max;
+            _fixed = other._fixed;
+            _v = new Type[_max];
+            _used = other.size();
+            for (uint i=other._start, j=0; i!=other._end; i=other._inc(i)) {
+                _v[j++] = other._v[i];
+            }
+            _start = 0;
+            _end = _used;
         }
-        _start = 0;
-        _end = _used;
         return (*this);
     }    
     
@@ -82,6 +111,35 @@ public:
     uint size() const {
         return _used;
     }
+
+    /** @return number of elements that fit before growing (or overwriting) */
+    uint capacity() const {
+        return _max - 1;
+    }
+
+    /** @return true if the next push will grow (or overwrite) */
+    bool full() const {
+        return _inc(_end) == _start;
+    }
+
+    /**
+     * Exposes all elements, in order, as two contiguous runs:
+     * [first, first + firstSize) followed by [second, second + secondSize).
+     * The second run is empty unless elements wrap around the end of
+     * the underlying array. Pointers are invalidated by any push.
+     */
+    void segments(const Type*& first, uint& firstSize,
+                  const Type*& second, uint& secondSize) const {
+        first = _v + _start;
+        second = _v;
+        if (_start + _used <= _max) {
+            firstSize = _used;
+            secondSize = 0;
+        } else {
+            firstSize = _max - _start;
+            secondSize = _used - firstSize;
+        }
+    }
     
     class Iterator {
     public:
@@ -147,7 +205,14 @@ public:
     /** */
     void push_back(const Type& e) {
         if (_inc(_end) == _start) {
-            _grow();
+            if ( ! _fixed) {
+                _grow();
+            } else if (_used == 0) {
+                return; // zero capacity
+            } else {
+                _start = _inc(_start);
+                _used --;
+            }
         }
         _v[_end] = e;
         _end = _inc(_end);
@@ -182,7 +247,14 @@ public:
     /**  */
     void push_front(const Type& e) {
         if (_dec(_start) == _end) {
-            _grow();
+            if ( ! _fixed) {
+                _grow();
+            } else if (_used == 0) {
+                return; // zero capacity
+            } else {
+                _end = _dec(_end);
+                _used --;
+            }
         }
         _start = _dec(_start);
         _v[_start] = e;
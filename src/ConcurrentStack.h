@@ -0,0 +1,120 @@
+/**
+ * @file ConcurrentStack.h
+ *
+ * A lock-free stack (Treiber stack).
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_CONCURRENT_STACK_H
+#define EDA_CONCURRENT_STACK_H
+
+#include <atomic>
+
+#include "Util.h"
+#include "Epoch.h"
+
+/**
+ * A stack that can be shared, without locks, by any number of threads:
+ * last in, first out. Offers the same push/pop operations as a Stack, but
+ * pop() returns the popped element (top() cannot be safely exposed when
+ * others may pop concurrently).
+ *
+ * Implemented as a linked list of nodes, where pushes and pops
+ * compare-and-swap the top pointer (R. K. Treiber, 1986). Popped nodes
+ * are retired to an EpochManager instead of being deleted, so that
+ * threads still reading them are safe, and the ABA problem cannot occur.
+ * Each stack has its own manager unless one is shared with it.
+ *
+ * @author mfreire
+ */
+template <class Type>
+class ConcurrentStack {
+
+    /** */
+    struct Node {
+        Type _elem;   ///< actual element stored in node
+        Node* _next;  ///< pointer to next node in stack, 0 if none
+
+        Node(const Type& e) : _elem(e), _next(0) {}
+    };
+
+    std::atomic<Node*> _top;    ///< top of the stack, 0 if empty
+    char _pad[EDA_CACHE_LINE];
+    std::atomic<uint> _size;    ///< number of elements in stack
+    EpochManager* _epochs;      ///< manages popped nodes
+    bool _ownsEpochs;           ///< true if _epochs must be deleted
+
+public:
+
+    /** uses its own EpochManager */
+    ConcurrentStack()
+        : _top(0), _size(0), _epochs(new EpochManager()), _ownsEpochs(true) {}
+
+    /** uses a shared EpochManager, which must outlive the stack */
+    ConcurrentStack(EpochManager& epochs)
+        : _top(0), _size(0), _epochs(&epochs), _ownsEpochs(false) {}
+
+    /** no thread may be using the stack */
+    ~ConcurrentStack() {
+        Node *n = _top.load();
+        while (n) {
+            Node *next = n->_next;
+            delete n;
+            n = next;
+        }
+        if (_ownsEpochs) {
+            delete _epochs;
+        }
+        _epochs = 0;
+    }
+
+    /**
+     * @return number of elements. Only exact if no other thread is
+     * concurrently modifying the stack
+     */
+    uint size() const {
+        return _size.load(std::memory_order_relaxed);
+    }
+
+    /**  */
+    void push(const Type& e) {
+        Node *n = new Node(e);
+        // counted before it is visible, so that size never underflows
+        _size.fetch_add(1, std::memory_order_relaxed);
+        n->_next = _top.load(std::memory_order_relaxed);
+        while ( ! _top.compare_exchange_weak(n->_next, n,
+                std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /**
+     * @return false (and does nothing) if the stack was empty
+     */
+    bool pop(Type& e) {
+        EpochManager::Guard guard(*_epochs);
+        Node *n = _top.load(std::memory_order_acquire);
+        while (n && ! _top.compare_exchange_weak(n, n->_next,
+                std::memory_order_acquire, std::memory_order_acquire));
+        if ( ! n) {
+            return false;
+        }
+        _size.fetch_sub(1, std::memory_order_relaxed);
+        e = n->_elem;
+        _epochs->retire(n);
+        return true;
+    }
+
+private:
+
+    // stacks are shared by reference; copying one makes no sense
+    ConcurrentStack(const ConcurrentStack&);
+    ConcurrentStack& operator=(const ConcurrentStack&);
+};
+
+#endif // EDA_CONCURRENT_STACK_H
@@ -0,0 +1,274 @@
+/**
+ * @file DeVector.h
+ *
+ * A double-ended dynamic vector: contiguous, with room at both ends.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_DEVECTOR_H
+#define EDA_DEVECTOR_H
+
+// to access std::sort
+#include <algorithm>
+
+#include "Util.h"
+
+DECLARE_EXCEPTION(DeVectorInvalidIndex)
+
+/**
+ * A dynamic vector that keeps spare room before its first element as
+ * well as after its last one. Like a Vector, elements are contiguous
+ * in memory (see data()), and random access is as fast as it gets; but,
+ * unlike a Vector, push_front and pop_front are also O(1) (amortized).
+ *
+ * When one end runs out of room, elements are re-centered in place if
+ * the vector is at most half full, or moved to a new buffer twice as
+ * large otherwise; either way, both ends are left with room to spare.
+ *
+ * @author mfreire
+ */
+template <class Type>
+class DeVector {
+
+    /// initial size to reserve for an empty vector
+    static const uint INITIAL_SIZE = 16;
+
+    Type* _v;     ///< dynamically-reserved array of elements
+    uint _start;  ///< index of first slot used
+    uint _used;   ///< number of slots used
+    uint _max;    ///< total number of slots in _v
+
+public:
+
+    /**  */
+    DeVector() : _start(INITIAL_SIZE / 2), _used(0), _max(INITIAL_SIZE) {
+        _v = new Type[_max];
+    }
+
+    /**  */
+    DeVector(const DeVector& other) :
+        _start(other._start), _used(other._used), _max(other._max) {
+
+        _v = new Type[_max];
+        for (uint i=0; i<_used; i++) {
+            _v[_start + i] = other._v[other._start + i];
+        }
+    }
+
+    /**  */
+    ~DeVector() {
+        delete[] _v;
+        _v = 0;
+    }
+
+    /** */
+    DeVector& operator=(const DeVector& other) {
+        if (&other != this) {
+            delete[] _v;
+            _max = other._max;
+            _start = other._start;
+            _used = other._used;
+            _v = new Type[_max];
+            for (uint i=0; i<_used; i++) {
+                _v[_start + i] = other._v[other._start + i];
+            }
+        }
+        return (*this);
+    }
+
+    /**  */
+    uint size() const {
+        return _used;
+    }
+
+    /**
+     * @return pointer to the first element; all elements are contiguous.
+     * Invalidated by any push.
+     */
+    const Type* data() const {
+        return _v + _start;
+    }
+
+    /**
+     * @return pointer to the first element; all elements are contiguous.
+     * Invalidated by any push.
+     */
+    Type* data() {
+        return _v + _start;
+    }
+
+    class Iterator {
+    public:
+        void next() {
+            _pos ++;
+        }
+
+        const Type& elem() const {
+            if (_pos >= _dv->_used) {
+                throw DeVectorInvalidIndex("elem");
+            }
+            return _dv->_v[_dv->_start + _pos];
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _pos == other._pos;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _pos != other._pos;
+        }
+    protected:
+        friend class DeVector;
+
+        const DeVector* _dv;
+
+        uint _pos;
+
+        Iterator(const DeVector *dv, uint pos)
+            : _dv(dv), _pos(pos) {}
+    };
+
+    /** */
+    Iterator begin() const {
+        return Iterator(this, 0);
+    }
+
+    /** */
+    const Iterator end() const {
+        return Iterator(this, _used);
+    }
+
+    /** */
+    void sort() {
+        std::sort(_v + _start, _v + _start + _used);
+    }
+
+    /** */
+    const Type& at(uint pos) const {
+        if (pos >= _used) {
+            throw DeVectorInvalidIndex("at");
+        }
+        return _v[_start + pos];
+    }
+
+    /** */
+    Type& at(uint pos) {
+        if (pos >= _used) {
+            throw DeVectorInvalidIndex("at");
+        }
+        return _v[_start + pos];
+    }
+
+    /** e may refer to an element of this vector */
+    void push_back(const Type& e) {
+        if (_start + _used == _max) {
+            Type copy = e;
+            _make_room();
+            _v[_start + _used++] = copy;
+        } else {
+            _v[_start + _used++] = e;
+        }
+    }
+
+    /** */
+    const Type& back() const {
+        if (_used == 0) {
+            throw DeVectorInvalidIndex("back");
+        }
+        return _v[_start + _used - 1];
+    }
+
+    /** */
+    Type& back() {
+        if (_used == 0) {
+            throw DeVectorInvalidIndex("back");
+        }
+        return _v[_start + _used - 1];
+    }
+
+    /**  */
+    void pop_back() {
+        if (_used == 0) {
+            throw DeVectorInvalidIndex("pop_back");
+        }
+        _used --;
+    }
+
+    /** e may refer to an element of this vector */
+    void push_front(const Type& e) {
+        if (_start == 0) {
+            Type copy = e;
+            _make_room();
+            _v[--_start] = copy;
+        } else {
+            _v[--_start] = e;
+        }
+        _used ++;
+    }
+
+    /**  */
+    const Type& front() const {
+        if (_used == 0) {
+            throw DeVectorInvalidIndex("front");
+        }
+        return _v[_start];
+    }
+
+    /**  */
+    Type& front() {
+        if (_used == 0) {
+            throw DeVectorInvalidIndex("front");
+        }
+        return _v[_start];
+    }
+
+    /**  */
+    void pop_front() {
+        if (_used == 0) {
+            throw DeVectorInvalidIndex("pop_front");
+        }
+        _start ++;
+        _used --;
+    }
+
+private:
+
+    /**
+     * Leaves room at both ends: re-centers elements if at most half
+     * full, and moves them to a buffer twice as large otherwise
+     */
+    void _make_room() {
+        if (_used <= _max / 2) {
+            uint start = (_max - _used) / 2;
+            if (start < _start) {
+                for (uint i=0; i<_used; i++) {
+                    _v[start + i] = _v[_start + i];
+                }
+            } else {
+                for (uint i=_used; i>0; i--) {
+                    _v[start + i - 1] = _v[_start + i - 1];
+                }
+            }
+            _start = start;
+        } else {
+            Type *old = _v;
+            uint start = (_max * 2 - _used) / 2;
+            _v = new Type[_max * 2];
+            for (uint i=0; i<_used; i++) {
+                _v[start + i] = old[_start + i];
+            }
+            _max *= 2;
+            _start = start;
+            delete[] old;
+        }
+    }
+};
+
+#endif // EDA_DEVECTOR_H
@@ -45,6 +45,11 @@ public:
         _v.push_front(e);
     }
 
+    /**  */
+    void pop_back() {
+        _v.pop_back();
+    }
+
     /**  */
     const Type& front() const {
         return _v.front();
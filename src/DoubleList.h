@@ -83,6 +83,9 @@ public:
 
     class Iterator {
     public:
+        /** an iterator that points nowhere (same as end()) */
+        Iterator() : _current(0) {}
+
         void next() {
             _current = _current->_next;
         }
@@ -314,8 +317,156 @@ public:
         other._size ++;
     }
     
+    /**
+     * Moves the elements in [first, last) of another list (which may
+     * also be this list) to just before pos. No nodes are allocated or
+     * copied, and iterators to moved elements remain valid. 
+     * O(1) if both lists are the same or the whole of 'other' is moved;
+     * O(k) otherwise, since the k moved elements must be counted.
+     * pos must not be inside [first, last).
+     * @param pos position to insert before; end() to append
+     * @param other list to move elements from
+     * @param first first element to move
+     * @param last element after the last one to move
+     */
+    void splice(const Iterator& pos, DoubleList& other,
+                const Iterator& first, const Iterator& last) {
+        if (first == last || (&other == this && pos == last)) {
+            return;
+        }
+        Node *f = first._current;
+        Node *l = last._current ? last._current->_prev : other._last;
+        uint count = 0;
+        if (&other != this) {
+            if (f == other._first && ! last._current) {
+                count = other._size;
+            } else {
+                for (Node *n = f; n != l; n = n->_next) {
+                    count ++;
+                }
+                count ++;
+            }
+        }
+        
+        // detach [f, l] from other
+        if (f->_prev) {
+            f->_prev->_next = l->_next;
+        } else {
+            other._first = l->_next;
+        }
+        if (l->_next) {
+            l->_next->_prev = f->_prev;
+        } else {
+            other._last = f->_prev;
+        }
+        other._size -= count;
+        
+        // and attach it before pos
+        Node *next = pos._current;
+        Node *prev = next ? next->_prev : _last;
+        f->_prev = prev;
+        l->_next = next;
+        if (prev) {
+            prev->_next = f;
+        } else {
+            _first = f;
+        }
+        if (next) {
+            next->_prev = l;
+        } else {
+            _last = l;
+        }
+        _size += count;
+    }
+    
+    /**
+     * Sorts the list using operator<, by relinking nodes (no allocation
+     * or copies). Stable bottom-up merge sort: O(n log n).
+     */
+    void sort() {
+        for (uint width = 1; width < _size; width *= 2) {
+            Node *head = 0, *tail = 0;
+            Node *rest = _first;
+            while (rest) {
+                Node *a = rest;
+                Node *b = _cut(a, width);
+                rest = _cut(b, width);
+                _mergeRuns(a, b, head, tail);
+            }
+            _first = head;
+            _last = tail;
+        }
+    }
+    
+    /**
+     * Merges another sorted list into this (sorted) one, emptying
+     * the other list in the process. Stable: on ties, elements from
+     * this list go first. O(n+m), with no allocation.
+     * @param other list to merge (will be emptied)
+     */
+    void merge(DoubleList& other) {
+        if (&other == this || other._size == 0) {
+            return;
+        }
+        Node *head = 0, *tail = 0;
+        _mergeRuns(_first, other._first, head, tail);
+        _first = head;
+        _last = tail;
+        _size += other._size;
+        other._first = other._last = 0;
+        other._size = 0;
+    }
+    
 private:
 
+    /**
+     * Cuts a chain of nodes after its first 'count' nodes.
+     * @return the first node after the cut, or 0 if none
+     */
+    static Node* _cut(Node *n, uint count) {
+        for (uint i=1; n && i<count; i++) {
+            n = n->_next;
+        }
+        if ( ! n) {
+            return 0;
+        }
+        Node *rest = n->_next;
+        n->_next = 0;
+        return rest;
+    }
+    
+    /** Appends a node to the chain [head, tail] */
+    static void _append(Node *n, Node*& head, Node*& tail) {
+        n->_prev = tail;
+        n->_next = 0;
+        if (tail) {
+            tail->_next = n;
+        } else {
+            head = n;
+        }
+        tail = n;
+    }
+    
+    /** Merges two sorted, 0-terminated chains onto [head, tail] */
+    static void _mergeRuns(Node *a, Node *b, Node*& head, Node*& tail) {
+        while (a && b) {
+            Node *n;
+            if (b->_elem < a->_elem) {
+                n = b;
+                b = b->_next;
+            } else {
+                n = a;
+                a = a->_next;
+            }
+            _append(n, head, tail);
+        }
+        for (Node *n = a ? a : b; n; ) {
+            Node *following = n->_next;
+            _append(n, head, tail);
+            n = following;
+        }
+    }
+
     Node* _detachLast() {
         Node *detached = _last;
         if (_size == 1) {
@@ -0,0 +1,262 @@
+/**
+ * @file Epoch.h
+ *
+ * Epoch-based memory reclamation for lock-free structures.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_EPOCH_H
+#define EDA_EPOCH_H
+
+#include <atomic>
+
+#include "Util.h"
+#include "Vector.h"
+
+DECLARE_EXCEPTION(EpochTooManyThreads)
+
+/**
+ * Assigns small, process-wide ids to threads, so that concurrent structures
+ * can keep per-thread state in plain arrays. Ids are assigned on first use,
+ * and released (for reuse by other threads) when their thread exits.
+ */
+class ThreadIds {
+public:
+    /// maximum number of threads that can hold an id at the same time
+    static const uint MAX_THREADS = 128;
+
+    /** @return the id of the calling thread, from 0 to MAX_THREADS-1 */
+    static uint id() {
+        static thread_local Holder holder;
+        return holder._id;
+    }
+
+    /** @return an upper bound on all ids currently in use */
+    static uint limit() {
+        return _limit().load(std::memory_order_acquire);
+    }
+
+private:
+
+    struct Holder {
+        uint _id;
+
+        Holder() {
+            std::atomic<bool>* taken = _taken();
+            for (_id = 0; _id < MAX_THREADS; _id ++) {
+                if ( ! taken[_id].load(std::memory_order_relaxed)
+                        && ! taken[_id].exchange(true)) {
+                    break;
+                }
+            }
+            if (_id == MAX_THREADS) {
+                throw EpochTooManyThreads("ThreadIds");
+            }
+            uint limit = _limit().load();
+            while (limit <= _id
+                    && ! _limit().compare_exchange_weak(limit, _id + 1));
+        }
+
+        ~Holder() {
+            _taken()[_id].store(false, std::memory_order_release);
+        }
+    };
+
+    static std::atomic<bool>* _taken() {
+        static std::atomic<bool> taken[MAX_THREADS];
+        return taken;
+    }
+
+    static std::atomic<uint>& _limit() {
+        static std::atomic<uint> limit(0);
+        return limit;
+    }
+};
+
+/**
+ * Decides when memory that was removed from a lock-free structure can be
+ * safely freed, even though other threads may still be reading it.
+ *
+ * Threads access the structure only while holding an EpochManager::Guard.
+ * Removed nodes are retire()d instead of deleted; they are freed once
+ * every thread that held a guard at the time of removal has released it.
+ * To know when that is, the manager keeps a global epoch number: guards
+ * announce the epoch they started in, and the epoch only advances once all
+ * active guards have seen the current one. Nodes retired in epoch e are
+ * therefore unreachable by any guard by the time the epoch reaches e+2.
+ *
+ * Since a retired node cannot be freed (and its address reused) while
+ * anyone may still hold a pointer to it, this also prevents the ABA problem
+ * in compare-and-swap loops over such pointers.
+ *
+ * A single manager can be shared by any number of structures.
+ *
+ * @author mfreire
+ */
+class EpochManager {
+
+    /// retirements between attempts to advance the epoch
+    static const uint RETIRES_PER_SCAN = 64;
+
+    /** a node waiting to be freed */
+    struct Retired {
+        void* _p;               ///< node to free
+        void (*_free)(void *);  ///< how to free it
+    };
+
+    /** per-thread state; only written by its own thread */
+    struct Slot {
+        std::atomic<ulong> _epoch;  ///< 2*epoch+1 if in a guard; 0 if not
+        uint _nesting;              ///< number of nested guards held
+        uint _retires;              ///< retirements since last scan
+        Vector<Retired>* _limbo[3]; ///< retired nodes, by epoch mod 3
+        ulong _limboEpoch[3];       ///< epoch of nodes in each _limbo
+        char _pad[EDA_CACHE_LINE];  ///< keeps slots in separate lines
+    };
+
+    std::atomic<ulong> _global;             ///< current epoch
+    char _pad[EDA_CACHE_LINE];
+    Slot _slots[ThreadIds::MAX_THREADS];    ///< indexed by ThreadIds::id()
+
+public:
+
+    /**
+     * Marks the calling thread as accessing shared nodes while in scope.
+     * Guards are cheap, and can be nested.
+     */
+    class Guard {
+    public:
+        Guard(EpochManager& m) : _m(m), _slot(m._slots[ThreadIds::id()]) {
+            if (_slot._nesting ++ == 0) {
+                ulong epoch = _m._global.load(std::memory_order_relaxed);
+                _slot._epoch.store(epoch*2 + 1, std::memory_order_relaxed);
+                // announcement must be visible before reading any node
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        ~Guard() {
+            if (-- _slot._nesting == 0) {
+                _slot._epoch.store(0, std::memory_order_release);
+            }
+        }
+    private:
+        EpochManager& _m;
+        Slot& _slot;
+
+        Guard(const Guard&);
+        Guard& operator=(const Guard&);
+    };
+
+    /**  */
+    EpochManager() {
+        _global.store(1, std::memory_order_relaxed);
+        for (uint i=0; i<ThreadIds::MAX_THREADS; i++) {
+            Slot& s = _slots[i];
+            s._epoch.store(0, std::memory_order_relaxed);
+            s._nesting = s._retires = 0;
+            for (uint j=0; j<3; j++) {
+                s._limbo[j] = 0;
+                s._limboEpoch[j] = 0;
+            }
+        }
+    }
+
+    /**
+     * Frees all retired nodes. No thread may be using any structure
+     * managed by this manager.
+     */
+    ~EpochManager() {
+        for (uint i=0; i<ThreadIds::MAX_THREADS; i++) {
+            for (uint j=0; j<3; j++) {
+                _free(_slots[i]._limbo[j]);
+                delete _slots[i]._limbo[j];
+            }
+        }
+    }
+
+    /**
+     * Schedules a node that is no longer reachable from its structure
+     * to be deleted once no guard can be accessing it.
+     */
+    template <class Type>
+    void retire(Type* p) {
+        retire(p, &_delete<Type>);
+    }
+
+    /**
+     * Schedules a node that is no longer reachable from its structure
+     * to be freed with a given function once no guard can be accessing it.
+     */
+    void retire(void* p, void (*free)(void *)) {
+        Slot& s = _slots[ThreadIds::id()];
+        ulong epoch = _global.load(std::memory_order_acquire);
+        uint j = epoch % 3;
+        if ( ! s._limbo[j]) {
+            s._limbo[j] = new Vector<Retired>();
+        } else if (s._limboEpoch[j] != epoch) {
+            // at least 3 epochs old, and therefore safe
+            _free(s._limbo[j]);
+        }
+        s._limboEpoch[j] = epoch;
+        Retired r = {p, free};
+        s._limbo[j]->push_back(r);
+        if (++ s._retires >= RETIRES_PER_SCAN) {
+            s._retires = 0;
+            _tryAdvance();
+            epoch = _global.load(std::memory_order_acquire);
+            for (j=0; j<3; j++) {
+                if (s._limboEpoch[j] + 2 <= epoch) {
+                    _free(s._limbo[j]);
+                }
+            }
+        }
+    }
+
+    /** @return current epoch; useful for diagnostics */
+    ulong epoch() const {
+        return _global.load(std::memory_order_relaxed);
+    }
+
+private:
+
+    // managers are shared by reference; copying one makes no sense
+    EpochManager(const EpochManager&);
+    EpochManager& operator=(const EpochManager&);
+
+    template <class Type>
+    static void _delete(void* p) {
+        delete static_cast<Type*>(p);
+    }
+
+    static void _free(Vector<Retired>* limbo) {
+        while (limbo && limbo->size()) {
+            Retired& r = limbo->back();
+            r._free(r._p);
+            limbo->pop_back();
+        }
+    }
+
+    /** advances the epoch if all active guards have seen it */
+    void _tryAdvance() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        ulong epoch = _global.load(std::memory_order_relaxed);
+        uint limit = ThreadIds::limit();
+        for (uint i=0; i<limit; i++) {
+            ulong seen = _slots[i]._epoch.load(std::memory_order_acquire);
+            if (seen && seen != epoch*2 + 1) {
+                return;
+            }
+        }
+        _global.compare_exchange_strong(epoch, epoch + 1);
+    }
+};
+
+#endif // EDA_EPOCH_H
@@ -0,0 +1,461 @@
+/**
+ * @file FrozenMap.h
+ *
+ * An immutable map, built once and then looked up with a single probe.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_FROZEN_MAP_H
+#define EDA_FROZEN_MAP_H
+
+#include "MapEntry.h"
+#include "Hash.h"
+#include "Util.h"
+
+DECLARE_EXCEPTION(FrozenMapNoSuchElement)
+DECLARE_EXCEPTION(FrozenMapDuplicateKey)
+
+/**
+ * A map that cannot change after being built, from any map (such as a
+ * HashTable, a TreeMap, or a Map::H) or range of map iterators. Lookups
+ * compute the slot of a key with a minimal perfect hash, and compare
+ * that slot's key with the one being looked up: one probe, and (for
+ * large maps) a single cache miss, instead of walking a chain of nodes.
+ * Entries are kept contiguously in a single array, with no empty slots,
+ * plus around 1 byte of hash parameters per entry.
+ *
+ * The perfect hash uses "hash and displace" (D. Belazzougui, F. C. Botelho
+ * and M. Dietzfelbinger, 2009; as simplified by G. E. Pibiri and R.
+ * Trani, 2021): keys are split into small buckets by their hashes, and,
+ * starting with the largest, each bucket gets the first 'pilot' that
+ * sends all of its keys to free slots. The slot of a key is then a hash
+ * of its own hash and of the pilot of its bucket. Buckets are placed
+ * into a few percent more slots than entries, as the last buckets would
+ * otherwise need very many tries to find the last free slots; the extra
+ * slots that end up in use are then remapped to the slots that did not.
+ *
+ * KeyType and ValueType must have default constructors, and keys must have
+ * distinct hashes (as they do, with overwhelming probability, unless
+ * repeated).
+ *
+ * @author mfreire
+ */
+template <class KeyType, class ValueType>
+class FrozenMap {
+public:
+
+    /** */
+    typedef MapEntry<KeyType, ValueType> Entry;
+
+private:
+
+    /** average number of keys per bucket */
+    static const uint BUCKET_SIZE = 2;
+
+    /** while placing buckets, there is an extra slot per EXTRA_SLOTS keys */
+    static const uint EXTRA_SLOTS = 16;
+
+    /** pilots tried for a bucket before choosing another seed */
+    static const uint MAX_PILOT = 0xffff;
+
+    Entry* _entries;      ///< one per entry
+    uint _size;           ///< number of entries
+    uint16_t* _pilots;    ///< one per bucket
+    uint _buckets;        ///< number of buckets
+    uint* _remap;         ///< entry for each extra slot, if used
+    uint _slots;          ///< entries, plus extra slots
+    uint64_t _seed;       ///< varies the positions that pilots lead to
+
+public:
+
+    /** an empty map */
+    FrozenMap() : _entries(0), _size(0), _pilots(0), _buckets(0),
+        _remap(0), _slots(0), _seed(0) {}
+
+    /**
+     * Builds a map with the entries of another, such as a HashTable or
+     * a Map::H; it must have begin(), end() and size(), and its iterators
+     * must have next(), key() and value()
+     */
+    template <class Map>
+    explicit FrozenMap(const Map& map)
+            : _entries(0), _size(0), _pilots(0), _buckets(0),
+              _remap(0), _slots(0), _seed(0) {
+        _build(map.begin(), map.end(), map.size());
+    }
+
+    /**
+     * Builds a map from a range of map iterators (with next(), key() and
+     * value())
+     * @throws FrozenMapDuplicateKey if a key is repeated
+     */
+    template <class MapIterator>
+    FrozenMap(MapIterator first, const MapIterator& last)
+            : _entries(0), _size(0), _pilots(0), _buckets(0),
+              _remap(0), _slots(0), _seed(0) {
+        uint n = 0;
+        for (MapIterator it = first; it != last; it.next()) {
+            n ++;
+        }
+        _build(first, last, n);
+    }
+
+    /** */
+    FrozenMap(const FrozenMap& other)
+            : _entries(0), _size(0), _pilots(0), _buckets(0),
+              _remap(0), _slots(0), _seed(0) {
+        _copy(other);
+    }
+
+    /** */
+    FrozenMap& operator=(const FrozenMap& other) {
+        if (this != &other) {
+            _clear();
+            _copy(other);
+        }
+        return *this;
+    }
+
+    /** */
+    ~FrozenMap() {
+        _clear();
+    }
+
+    /** */
+    uint size() const {
+        return _size;
+    }
+
+    /** @return approximate memory used by the map, in bytes */
+    ulong bytes() const {
+        return sizeof(*this) + (ulong)_size * sizeof(Entry)
+            + (ulong)_buckets * sizeof(uint16_t)
+            + (ulong)(_slots - _size) * sizeof(uint);
+    }
+
+    class Iterator {
+    public:
+        void next() {
+            _current ++;
+        }
+
+        const Entry& elem() const {
+            return *_current;
+        }
+
+        const ValueType& value() const {
+            return _current->_value;
+        }
+
+        const KeyType& key() const {
+            return _current->_key;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _current == other._current;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _current != other._current;
+        }
+    protected:
+        friend class FrozenMap;
+
+        const Entry* _current;
+
+        Iterator(const Entry* current) : _current(current) {}
+    };
+
+    /** iterates entries in no particular order */
+    Iterator begin() const {
+        return Iterator(_entries);
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(_entries + _size);
+    }
+
+    /** */
+    Iterator find(const KeyType& key) const {
+        const Entry* e = _find(key);
+        return e ? Iterator(e) : end();
+    }
+
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, Iterator>::type
+    find(const Other& key) const {
+        const Entry* e = _find(key);
+        return e ? Iterator(e) : end();
+    }
+
+    /** */
+    const ValueType& at(const KeyType& key) const {
+        return _at(key);
+    }
+
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, const ValueType&>::type
+    at(const Other& key) const {
+        return _at(key);
+    }
+
+    /** */
+    bool contains(const KeyType& key) const {
+        return _find(key) != 0;
+    }
+
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, bool>::type
+    contains(const Other& key) const {
+        return _find(key) != 0;
+    }
+
+private:
+
+    /** @return x scaled from [0, 2^64) to [0, n) */
+    static uint _reduce(uint64_t x, uint n) {
+        uint64_t lo, hi;
+        hash_mul128(x, n, lo, hi);
+        return (uint)hi;
+    }
+
+    /** @return slot of a key with hash h, in a bucket with a given pilot */
+    uint _slotFor(uint64_t h, uint pilot) const {
+        return _reduce(hash_int(h ^ hash_int(_seed + pilot)), _slots);
+    }
+
+    /** @return entry for a slot */
+    uint _entryFor(uint slot) const {
+        return (slot < _size) ? slot : _remap[slot - _size];
+    }
+
+    template <class Key>
+    const Entry* _find(const Key& key) const {
+        if (_size == 0) {
+            return 0;
+        }
+        uint64_t h = hash(key);
+        const Entry* e = _entries
+            + _entryFor(_slotFor(h, _pilots[_reduce(h, _buckets)]));
+        return (e->_key == key) ? e : 0;
+    }
+
+    template <class Key>
+    const ValueType& _at(const Key& key) const {
+        const Entry* e = _find(key);
+        if ( ! e) {
+            throw FrozenMapNoSuchElement("at");
+        }
+        return e->_value;
+    }
+
+    void _clear() {
+        delete[] _entries;
+        delete[] _pilots;
+        delete[] _remap;
+        _entries = 0;
+        _pilots = 0;
+        _remap = 0;
+        _size = _buckets = _slots = 0;
+    }
+
+    void _copy(const FrozenMap& other) {
+        _entries = new Entry[other._size];
+        for (uint i=0; i<other._size; i++) {
+            _entries[i] = other._entries[i];
+        }
+        _pilots = new uint16_t[other._buckets];
+        for (uint i=0; i<other._buckets; i++) {
+            _pilots[i] = other._pilots[i];
+        }
+        _remap = new uint[other._slots - other._size];
+        for (uint i=0; i<other._slots - other._size; i++) {
+            _remap[i] = other._remap[i];
+        }
+        _size = other._size;
+        _buckets = other._buckets;
+        _slots = other._slots;
+        _seed = other._seed;
+    }
+
+    /**
+     * Builds the map from n entries; throws if two of them have
+     * the same hash, since no pilot could separate them
+     */
+    template <class MapIterator>
+    void _build(MapIterator first, const MapIterator& last, uint n) {
+        _size = n;
+        _buckets = n / BUCKET_SIZE + 1;
+        _entries = new Entry[n];
+        _pilots = new uint16_t[_buckets];
+        _slots = n + n / EXTRA_SLOTS;
+        _remap = new uint[_slots - n];
+        uint64_t* hashes = new uint64_t[n];
+        // counting sort of entry indices by bucket, into 'members'
+        uint* start = new uint[_buckets + 1];
+        uint* members = new uint[n ? n : 1];
+        Entry* pending = new Entry[n];
+        try {
+            for (uint b=0; b<=_buckets; b++) {
+                start[b] = 0;
+            }
+            uint i = 0;
+            for (MapIterator it = first; it != last; it.next(), i++) {
+                pending[i] = Entry(it.key(), it.value());
+                hashes[i] = hash(it.key());
+                start[_reduce(hashes[i], _buckets) + 1] ++;
+            }
+            for (uint b=0; b<_buckets; b++) {
+                start[b + 1] += start[b];
+            }
+            uint* filled = new uint[_buckets];
+            for (uint b=0; b<_buckets; b++) {
+                filled[b] = start[b];
+            }
+            for (i=0; i<n; i++) {
+                members[filled[_reduce(hashes[i], _buckets)] ++] = i;
+            }
+            delete[] filled;
+            _checkDistinct(pending, hashes, start, members);
+            while ( ! _place(hashes, start, members)) {
+                _seed = hash_int(_seed + 1);
+            }
+            for (uint b=0; b<_buckets; b++) {
+                for (uint j=start[b]; j<start[b + 1]; j++) {
+                    uint e = members[j];
+                    _entries[_entryFor(_slotFor(hashes[e], _pilots[b]))] = pending[e];
+                }
+            }
+        } catch (...) {
+            delete[] hashes;
+            delete[] start;
+            delete[] members;
+            delete[] pending;
+            _clear();
+            throw;
+        }
+        delete[] hashes;
+        delete[] start;
+        delete[] members;
+        delete[] pending;
+    }
+
+    /** throws if two entries of the same bucket have the same hash */
+    void _checkDistinct(const Entry* pending, const uint64_t* hashes,
+            const uint* start, const uint* members) const {
+        for (uint b=0; b<_buckets; b++) {
+            for (uint j=start[b]; j<start[b + 1]; j++) {
+                for (uint k=j + 1; k<start[b + 1]; k++) {
+                    if (hashes[members[j]] != hashes[members[k]]) {
+                        continue;
+                    }
+                    throw FrozenMapDuplicateKey(
+                        pending[members[j]]._key == pending[members[k]]._key ?
+                            "repeated key" : "distinct keys with equal hashes");
+                }
+            }
+        }
+    }
+
+    /**
+     * Finds a pilot for each bucket, largest buckets first, and then
+     * remaps used extra slots to unused entries
+     * @return false if some bucket ran out of pilots with this seed
+     */
+    bool _place(const uint64_t* hashes, const uint* start, const uint* members) {
+        // counting sort of buckets by decreasing size
+        uint largest = 0;
+        for (uint b=0; b<_buckets; b++) {
+            uint s = start[b + 1] - start[b];
+            largest = (s > largest) ? s : largest;
+        }
+        uint* bySize = new uint[largest + 2];
+        for (uint s=0; s<largest + 2; s++) {
+            bySize[s] = 0;
+        }
+        for (uint b=0; b<_buckets; b++) {
+            bySize[largest - (start[b + 1] - start[b]) + 1] ++;
+        }
+        for (uint s=0; s<=largest; s++) {
+            bySize[s + 1] += bySize[s];
+        }
+        uint* order = new uint[_buckets];
+        for (uint b=0; b<_buckets; b++) {
+            order[bySize[largest - (start[b + 1] - start[b])] ++] = b;
+        }
+        delete[] bySize;
+
+        uint words = (_slots + 63) / 64;
+        uint64_t* taken = new uint64_t[words ? words : 1];
+        for (uint w=0; w<words; w++) {
+            taken[w] = 0;
+        }
+        uint* slots = new uint[largest ? largest : 1];
+        bool placed = true;
+        for (uint o=0; o<_buckets && placed; o++) {
+            uint b = order[o];
+            uint s = start[b + 1] - start[b];
+            _pilots[b] = 0;
+            if (s == 0) {
+                continue;
+            }
+            for (uint pilot=0; ; pilot++) {
+                uint64_t k = hash_int(_seed + pilot);
+                uint j = 0;
+                for ( ; j<s; j++) {
+                    uint slot = _reduce(hash_int(hashes[members[start[b] + j]] ^ k), _slots);
+                    if (taken[slot / 64] & (1ULL << (slot % 64))) {
+                        break;
+                    }
+                    // keys of the bucket must not collide with each other
+                    uint c = 0;
+                    while (c < j && slots[c] != slot) {
+                        c ++;
+                    }
+                    if (c < j) {
+                        break;
+                    }
+                    slots[j] = slot;
+                }
+                if (j == s) {
+                    for (j=0; j<s; j++) {
+                        taken[slots[j] / 64] |= 1ULL << (slots[j] % 64);
+                    }
+                    _pilots[b] = pilot;
+                    break;
+                }
+                if (pilot == MAX_PILOT) {
+                    placed = false;
+                    break;
+                }
+            }
+        }
+        // as many extra slots are used as entries are not
+        for (uint slot=_size, free=0; placed && slot<_slots; slot++) {
+            _remap[slot - _size] = 0;
+            if (taken[slot / 64] & (1ULL << (slot % 64))) {
+                while (taken[free / 64] & (1ULL << (free % 64))) {
+                    free ++;
+                }
+                _remap[slot - _size] = free ++;
+            }
+        }
+        delete[] order;
+        delete[] taken;
+        delete[] slots;
+        return placed;
+    }
+};
+
+#endif // EDA_FROZEN_MAP_H
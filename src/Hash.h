@@ -0,0 +1,229 @@
+/**
+ * @file Hash.h
+ *
+ * Hash functions for keys of hashed containers.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_HASH_H
+#define EDA_HASH_H
+
+#include <string>
+#include <cstring>
+#include <stdint.h>
+
+#include "Util.h"
+
+/*
+ * All hashes are 64-bit, and well-mixed: every bit of the key affects
+ * every bit of the hash. Containers can therefore use the lowest bits of
+ * a hash directly as a bin index. Hashing is based on a 64x64->128-bit
+ * multiplication, whose two halves are xor-ed together ("mum"); byte
+ * sequences are read 8 bytes at a time, as in wyhash (Wang Yi, 2019).
+ *
+ * Containers call hash(key) unqualified: within a template, ordinary
+ * lookup only finds the hash()es declared before it, but
+ * argument-dependent lookup also finds those declared later for class
+ * keys (such as that of StringRef, which includes this file).
+ */
+
+/// odd 64-bit constants with well-distributed bits (from wyhash)
+static const uint64_t EDA_HASH_P0 = 0xa0761d6478bd642fULL;
+static const uint64_t EDA_HASH_P1 = 0xe7037ed1a0b428dbULL;
+static const uint64_t EDA_HASH_P2 = 0x8ebc6af09c88c6e3ULL;
+static const uint64_t EDA_HASH_P3 = 0x589965cc75374cc3ULL;
+
+/**
+ * Full 128-bit product of a and b, as its low and high halves
+ */
+inline void hash_mul128(uint64_t a, uint64_t b, uint64_t& lo, uint64_t& hi) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 uint128;
+    uint128 r = (uint128)a * b;
+    lo = (uint64_t)r;
+    hi = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    lo = t + (rm1 << 32);
+    c += lo < t;
+    hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+/**
+ * Mixes two 64-bit values into one: multiplies them, and folds the
+ * 128-bit result in half
+ */
+inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+    uint64_t lo, hi;
+    hash_mul128(a, b, lo, hi);
+    return lo ^ hi;
+}
+
+/**
+ * Mixes the bits of an integer (the finalizer of SplitMix64); a bijection,
+ * so distinct integers never collide
+ */
+inline uint64_t hash_int(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/// reads 8 bytes, which need not be aligned
+inline uint64_t hash_read8(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+/// reads 4 bytes, which need not be aligned
+inline uint64_t hash_read4(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+/**
+ * Hashes len bytes starting at data, 16 (or, for long inputs, 48)
+ * bytes at a time
+ */
+inline uint64_t hash_bytes(const void* data, size_t len, uint64_t seed = 0) {
+    const unsigned char* p = (const unsigned char*)data;
+    seed ^= hash_mix(seed ^ EDA_HASH_P0, EDA_HASH_P1);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            // two overlapping reads from each end cover 4 to 16 bytes
+            size_t mid = (len >> 3) << 2;
+            a = (hash_read4(p) << 32) | hash_read4(p + mid);
+            b = (hash_read4(p + len - 4) << 32) | hash_read4(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            // three independent lanes, to keep the multiplier busy
+            uint64_t s1 = seed, s2 = seed;
+            do {
+                seed = hash_mix(hash_read8(p) ^ EDA_HASH_P1,
+                                hash_read8(p + 8) ^ seed);
+                s1 = hash_mix(hash_read8(p + 16) ^ EDA_HASH_P2,
+                              hash_read8(p + 24) ^ s1);
+                s2 = hash_mix(hash_read8(p + 32) ^ EDA_HASH_P3,
+                              hash_read8(p + 40) ^ s2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= s1 ^ s2;
+        }
+        while (i > 16) {
+            seed = hash_mix(hash_read8(p) ^ EDA_HASH_P1, hash_read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        // last 16 bytes, which may overlap those already read
+        a = hash_read8(p + i - 16);
+        b = hash_read8(p + i - 8);
+    }
+    uint64_t lo, hi;
+    hash_mul128(a ^ EDA_HASH_P1, b ^ seed, lo, hi);
+    return hash_mix(lo ^ EDA_HASH_P0 ^ len, hi ^ EDA_HASH_P1);
+}
+
+/// hash for chars
+inline uint64_t hash(char key) {
+    return hash_int((unsigned char)key);
+}
+
+/// hash for (signed) ints
+inline uint64_t hash(int key) {
+    return hash_int((uint64_t)(long long)key);
+}
+
+/// hash for (unsigned) ints
+inline uint64_t hash(uint key) {
+    return hash_int(key);
+}
+
+/// hash for (signed) longs
+inline uint64_t hash(long key) {
+    return hash_int((uint64_t)key);
+}
+
+/// hash for (unsigned) longs
+inline uint64_t hash(ulong key) {
+    return hash_int(key);
+}
+
+/// hash for (signed) long longs
+inline uint64_t hash(long long key) {
+    return hash_int((uint64_t)key);
+}
+
+/// hash for (unsigned) long longs
+inline uint64_t hash(unsigned long long key) {
+    return hash_int(key);
+}
+
+/// hash for strings; looks at 8 bytes at a time
+inline uint64_t hash(const std::string& key) {
+    return hash_bytes(key.data(), key.size());
+}
+
+/// hash for C strings; same as that of the equivalent std::string
+inline uint64_t hash(const char* key) {
+    return hash_bytes(key, strlen(key));
+}
+
+#if __cplusplus >= 201703L
+/// hash for string views; same as that of the equivalent std::string
+inline uint64_t hash(std::string_view key) {
+    return hash_bytes(key.data(), key.size());
+}
+#endif
+
+/**
+ * Generic hash function for user classes, which must provide
+ * a hash() method. Its result is mixed, so it need not be well
+ * distributed; but equal keys must return equal values.
+ */
+template<class KeyType>
+uint64_t hash(const KeyType& key) {
+    return hash_int(key.hash());
+}
+
+/**
+ * Mixes the hash of v into seed, to hash keys with several fields:
+ * <pre>
+ * uint64_t hash() const {
+ *     uint64_t h = 0;
+ *     hash_combine(h, _name);
+ *     hash_combine(h, _age);
+ *     return h;
+ * }
+ * </pre>
+ * The order of the fields matters.
+ */
+template<class Type>
+void hash_combine(uint64_t& seed, const Type& v) {
+    seed = hash_mix(seed ^ EDA_HASH_P0, hash(v) ^ EDA_HASH_P1);
+}
+
+#endif // EDA_HASH_H
@@ -15,91 +15,316 @@
 #ifndef EDA_HASHTABLE_H
 #define EDA_HASHTABLE_H
 
+#include <ctime>
+#include <iomanip>
+
 #include "MapEntry.h"
+#include "Hash.h"
 #include "Util.h"
+#include "DoubleList.h"
+#include "Vector.h"
 
 DECLARE_EXCEPTION(HashTableNoSuchElement)
 
-/// hash for (unsigned) ints
-inline uint hash(uint key) {
-    return key;
+/**
+ * Hash of a key, as containers compute it (with an unqualified call; see
+ * Hash.h); for use in classes whose own hash() member would hide it
+ */
+template <class KeyType>
+uint64_t hash_key(const KeyType& key) {
+    return hash(key);
 }
 
-/// hash for (signed) ints
-inline uint hash(int key) {
-    return (uint)key;
-}
+/**
+ * A MapEntry as stored in a HashTable: can recompute its hash, and
+ * tell whether it matches a key with a given hash.
+ */
+template <class KeyType, class ValueType, bool CACHE_HASHES>
+struct HashEntry : public MapEntry<KeyType, ValueType> {
+    HashEntry(const KeyType& key, const ValueType& value, uint64_t)
+        : MapEntry<KeyType, ValueType>(key, value) {}
 
-/// hash for chars
-inline uint hash(char key) {
-    return (uint)key;
-}
+    uint64_t hash() const {
+        return hash_key(this->_key);
+    }
 
-/// used in Java jdk7
-inline uint hash(std::string key) {
-    uint h = 0;
-    for (uint i=0; i<key.length(); i++) {
-        h = 31*h + key[i];
+    template <class Key>
+    bool matches(const Key& key, uint64_t) const {
+        return this->_key == key;
     }
-    return h;
-}
+};
 
 /**
- * Generic hash function for user classes
+ * A HashTable entry that also stores the full hash of its key: growing
+ * needs no rehashing, and keys are only compared if their hashes match.
  */
-template<class KeyType>
-uint hash(const KeyType& key) {
-    return key.hash();
-}
+template <class KeyType, class ValueType>
+struct HashEntry<KeyType, ValueType, true> : public MapEntry<KeyType, ValueType> {
+    uint64_t _hash;   ///< hash of _key
+
+    HashEntry(const KeyType& key, const ValueType& value, uint64_t hash)
+        : MapEntry<KeyType, ValueType>(key, value), _hash(hash) {}
+
+    uint64_t hash() const {
+        return _hash;
+    }
+
+    template <class Key>
+    bool matches(const Key& key, uint64_t hash) const {
+        return _hash == hash && this->_key == key;
+    }
+};
+
+/**
+ * Statistics on a hash table, to tune its sizing and to detect bad hash
+ * functions. The first group describes the table as it is, and is
+ * always available. The second counts what happened since the table was
+ * built (or its stats reset), and is only kept if compiled with
+ * EDA_HASHTABLE_STATS defined; otherwise, it is all 0. Probes are key
+ * comparisons (entries looked at) during lookups, insertions and
+ * removals (but not during bulk loads); to lower the overhead of
+ * counting them, define EDA_HASHTABLE_STATS_SAMPLING as a power of 2,
+ * N, to count only 1 in N of them.
+ *
+ * Counting writes to the table even in const lookups (find, at,
+ * contains): with EDA_HASHTABLE_STATS defined, threads can no longer
+ * look up keys in a shared table without locking, as they could without
+ * it. Counters are plain integers, to keep them cheap.
+ */
+struct HashTableStats {
+    uint bins;                  ///< number of bins (or slots)
+    uint entries;               ///< number of entries
+    double loadFactor;          ///< entries per bin
+    ulong bytes;                ///< approximate memory used by the table
+    uint longestChain;          ///< most entries in any bin
+    double expectedHitProbes;   ///< average probes to find an existing key
+    double expectedMissProbes;  ///< average probes to look for a missing key
+
+    ulong finds;                ///< calls to find, at and contains
+    ulong inserts;              ///< calls to insert
+    ulong erases;               ///< calls to erase
+    ulong hits;                 ///< sampled searches that found their key
+    ulong misses;               ///< sampled searches that did not
+    ulong hitProbes;            ///< total probes of sampled hits
+    ulong missProbes;           ///< total probes of sampled misses
+    uint maxHitProbes;          ///< most probes of any sampled hit
+    uint maxMissProbes;         ///< most probes of any sampled miss
+    uint grows;                 ///< times that the table grew
+    uint shrinks;               ///< times that the table shrank
+    double growSeconds;         ///< processor time spent growing or shrinking
+
+    HashTableStats() : bins(0), entries(0), loadFactor(0), bytes(0),
+        longestChain(0), expectedHitProbes(0), expectedMissProbes(0),
+        finds(0), inserts(0), erases(0), hits(0), misses(0),
+        hitProbes(0), missProbes(0), maxHitProbes(0), maxMissProbes(0),
+        grows(0), shrinks(0), growSeconds(0) {}
+
+    /**  */
+    double averageHitProbes() const {
+        return hits ? (double)hitProbes / hits : 0;
+    }
+
+    /**  */
+    double averageMissProbes() const {
+        return misses ? (double)missProbes / misses : 0;
+    }
+
+    /** prints all stats as 'name value' lines */
+    void print(std::ostream &out=std::cout) const {
+        out << "bins " << bins << std::endl
+            << "entries " << entries << std::endl
+            << "loadFactor " << loadFactor << std::endl
+            << "bytes " << bytes << std::endl
+            << "longestChain " << longestChain << std::endl
+            << "expectedHitProbes " << expectedHitProbes << std::endl
+            << "expectedMissProbes " << expectedMissProbes << std::endl
+            << "finds " << finds << std::endl
+            << "inserts " << inserts << std::endl
+            << "erases " << erases << std::endl
+            << "hits " << hits << std::endl
+            << "misses " << misses << std::endl
+            << "averageHitProbes " << averageHitProbes() << std::endl
+            << "averageMissProbes " << averageMissProbes() << std::endl
+            << "maxHitProbes " << maxHitProbes << std::endl
+            << "maxMissProbes " << maxMissProbes << std::endl
+            << "grows " << grows << std::endl
+            << "shrinks " << shrinks << std::endl
+            << "growSeconds " << growSeconds << std::endl;
+    }
+};
+
+#ifndef EDA_HASHTABLE_STATS_SAMPLING
+#define EDA_HASHTABLE_STATS_SAMPLING 1
+#endif
+
+#ifdef EDA_HASHTABLE_STATS
+/**
+ * Usage counters of a hash table, as reported in its HashTableStats
+ */
+class HashTableCounters {
+    HashTableStats _s;    ///< only its counters are used
+    ulong _searches;      ///< to sample 1 in EDA_HASHTABLE_STATS_SAMPLING
+    std::clock_t _growStart;
+
+public:
+    HashTableCounters() : _searches(0), _growStart(0) {}
+
+    void found() { _s.finds ++; }
+    void inserted(ulong n = 1) { _s.inserts += n; }
+    void erased() { _s.erases ++; }
+
+    void searched(uint probes, bool hit) {
+        if ((_searches ++ & (EDA_HASHTABLE_STATS_SAMPLING - 1)) != 0) {
+            return;
+        }
+        if (hit) {
+            _s.hits ++;
+            _s.hitProbes += probes;
+            _s.maxHitProbes = probes > _s.maxHitProbes ? probes : _s.maxHitProbes;
+        } else {
+            _s.misses ++;
+            _s.missProbes += probes;
+            _s.maxMissProbes = probes > _s.maxMissProbes ? probes : _s.maxMissProbes;
+        }
+    }
+
+    void resizeStarted() {
+        _growStart = std::clock();
+    }
+
+    void resizeEnded(bool grew) {
+        if (grew) {
+            _s.grows ++;
+        } else {
+            _s.shrinks ++;
+        }
+        _s.growSeconds += (double)(std::clock() - _growStart) / CLOCKS_PER_SEC;
+    }
+
+    /** @return stats with only the counters filled in */
+    HashTableStats counts() const {
+        return _s;
+    }
+};
+#else
+/**
+ * Does nothing, since EDA_HASHTABLE_STATS is not defined; all calls
+ * vanish when inlined
+ */
+class HashTableCounters {
+public:
+    void found() {}
+    void inserted(ulong = 1) {}
+    void erased() {}
+    void searched(uint, bool) {}
+    void resizeStarted() {}
+    void resizeEnded(bool) {}
+    HashTableStats counts() const { return HashTableStats(); }
+};
+#endif
 
 /**
  * An open hash-table. Insertion, existence and
  * removal are quick -- as long as the hash-function
- * for the keys is good.
+ * for the keys is good (see Hash.h).
+ * 
+ * Keys can also be looked up (find, at, contains) through other types,
+ * without converting them into KeyType, if marked as a TransparentKey
+ * (for example, <code>const char*</code> for <code>std::string</code> keys).
+ * 
+ * If CACHE_HASHES is true, each entry stores the hash of its key (8 more
+ * bytes per entry): worth it for keys that are slow to hash or compare,
+ * such as strings.
+ * 
+ * stats() describes how well the table is working; see HashTableStats.
+ * 
+ * A bitmap marks which bins are not empty, so that iterators skip empty
+ * ones 64 at a time: iterating a large but sparse table is fast. Tables
+ * only shrink as entries are erased if setShrinkOnErase(true) is called.
+ * 
+ * ParallelHashTable (C++11) builds and grows large tables with several
+ * threads.
  * 
  * @author mfreire
  */
-template <class KeyType, class ValueType>
+template <class KeyType, class ValueType, bool CACHE_HASHES = false>
 class HashTable {
     typedef MapEntry<KeyType, ValueType> Entry;
-    typedef DoubleList<Entry> Bin;
+    typedef HashEntry<KeyType, ValueType, CACHE_HASHES> Stored;
+    typedef DoubleList<Stored> Bin;
     typedef typename Bin::Iterator BinIterator;
     
-    /** if _entryCount * _size exceed this, grow */
+    /** if _entryCount / _size reaches this, grow */
     static const uint MAX_LOAD_FACTOR = 4;
     
-    /** initial number of bins */
+    /** if shrinking on erase, shrink when _entryCount * this < _size */
+    static const uint MIN_LOAD_DIVISOR = 2;
+    
+    /** initial number of bins; must be a power of 2 */
     static const uint INITIAL_SIZE = 16;
     
+    /** keys looked up together by batch operations */
+    static const uint BATCH = 32;
+    
     Bin* _bins;         ///< bins to store elements in
-    uint _size;         ///< current number of bins
+    uint64_t* _occupied; ///< bit i set if _bins[i] is not empty
+    uint _size;         ///< current number of bins; always a power of 2
     uint _entryCount;   ///< number of key-value entries stored
+    bool _shrink;       ///< if true, shrink as entries are erased
+    mutable HashTableCounters _counters; ///< see HashTableStats
+    
+    /** builds and grows tables in parallel; see ParallelHashTable.h */
+    template <class K, class V, bool C> friend class ParallelHashTable;
 
 public:
 
     /**  */
-    HashTable() : _size(INITIAL_SIZE), _entryCount(0) {
+    HashTable() : _size(INITIAL_SIZE), _entryCount(0), _shrink(false) {
         _bins = new Bin[_size];
+        _occupied = new uint64_t[_words(_size)]();
+    }
+    
+    /**  */
+    HashTable(const HashTable& other) : _bins(0), _occupied(0) {
+        *this = other;
     }
     
     /**  */
     ~HashTable() {
         delete[] _bins;
+        delete[] _occupied;
         _bins = 0;
     }
     
     /** */
     HashTable& operator=(const HashTable& other) {
+        if (this == &other) {
+            return (*this);
+        }
         delete[] _bins;
+        delete[] _occupied;
         _size = other._size;
         _bins = new Bin[_size];
+        _occupied = new uint64_t[_words(_size)];
         _entryCount = other.size();
-        for (uint i=0; i<other.size(); i++) {
+        _shrink = other._shrink;
+        for (uint i=0; i<_size; i++) {
             _bins[i] = other._bins[i];
         }
+        for (uint i=0; i<_words(_size); i++) {
+            _occupied[i] = other._occupied[i];
+        }
         return (*this);
     }    
 
+    /**
+     * If enabled, the table halves its number of bins whenever less than
+     * half of them would be used; otherwise (the default) it only grows
+     */
+    void setShrinkOnErase(bool enabled) {
+        _shrink = enabled;
+    }
+
     /**  */
     uint size() const {
         return _entryCount;
@@ -149,30 +374,45 @@ public:
             _advance();
         }
         
+        /** if at the end of a bin, moves on to the next non-empty one */
         void _advance() {
-            while (_it == _bin->end() && _bin < _lastBin) {
+            // in dense tables, the next few bins are cheaper to just check
+            for (uint i=0; i<4 && _it == _bin->end() && _bin < _lastBin; i++) {
                 _bin ++;
                 _it = _bin->begin();
             }
+            if (_it == _bin->end() && _bin < _lastBin) {
+                uint next = _hm->_nextOccupied(_bin - _hm->_bins + 1);
+                _bin = _hm->_bins + (next < _hm->_size ? next : _hm->_size - 1);
+                _it = _bin->begin();
+            }
         }
     };
     
     /** */
     const Iterator find(const KeyType& key) const {
-        Bin& bin = _bins[_binFor(key)];
-        const BinIterator& it = _findIn(bin, key);
-        return (it == bin.end()) ? end() 
-            : Iterator(this, &bin, it);
+        return _find(key);
     }
 
     /** */
     Iterator find(const KeyType& key) {
-        Bin& bin = _bins[_binFor(key)];
-        const BinIterator& it = _findIn(bin, key);
-        return (it == bin.end()) ? end() 
-            : Iterator(this, &bin, it);
+        return _find(key);
     }    
     
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, Iterator>::type
+    find(const Other& key) const {
+        return _find(key);
+    }
+
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, Iterator>::type
+    find(const Other& key) {
+        return _find(key);
+    }
+    
     /** */
     Iterator begin() const {
         return Iterator(this, _bins+0, _bins[0].begin());
@@ -185,51 +425,148 @@ public:
     
     /** */
     const ValueType& at(const KeyType& key) const {        
-        const Bin& bin  = _bins[_binFor(key)];
-        const BinIterator it = _findIn(bin, key);
-        if (it == bin.end()) {
-            throw HashTableNoSuchElement("at");
-        }
-        return it.elem()._value;
+        return _at(key);
     }
     
     /** */
     ValueType& at(const KeyType& key) {
-        Bin& bin  = _bins[_binFor(key)];
-        BinIterator it = _findIn(bin, key);
-        if (it == bin.end()) {
-            throw HashTableNoSuchElement("at");
-        }
-        return it.elem()._value;        
+        return _at(key);
+    }
+    
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, const ValueType&>::type
+    at(const Other& key) const {
+        return _at(key);
+    }
+    
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, ValueType&>::type
+    at(const Other& key) {
+        return _at(key);
     }
     
     /** */
-    void insert(const KeyType& key, const ValueType& value) {
-        Bin& bin  = _bins[_binFor(key)];
-        BinIterator it = _findIn(bin, key);
-        if (it == bin.end()) {
-            bin.push_back(Entry(key, value));
-            _entryCount ++;
-            if (_entryCount / _size >= MAX_LOAD_FACTOR) {
-                _grow();
+    bool contains(const KeyType& key) const {
+        return _find(key) != end();
+    }
+    
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, bool>::type
+    contains(const Other& key) const {
+        return _find(key) != end();
+    }
+    
+    /**
+     * Looks up n keys, faster than one at a time in tables much larger
+     * than the cache: hashes a group of keys, prefetches their bins and
+     * the first entry of each, and only then searches them, so that
+     * their cache misses overlap instead of coming one after another.
+     * @param values set to a pointer to the value of each key, or to 0 if
+     * not found; pointers are valid until the table changes
+     */
+    void find_batch(const KeyType* keys, uint n, ValueType** values) {
+        Stored* found[BATCH];
+        for (uint start=0; start<n; start+=BATCH) {
+            uint m = (n - start < BATCH) ? n - start : BATCH;
+            _findGroup(keys + start, m, found);
+            for (uint i=0; i<m; i++) {
+                values[start + i] = found[i] ? &found[i]->_value : 0;
+            }
+        }
+    }
+    
+    /**
+     * Like find_batch
+     * @param results set to whether each key is in the table
+     */
+    void contains_batch(const KeyType* keys, uint n, bool* results) const {
+        Stored* found[BATCH];
+        for (uint start=0; start<n; start+=BATCH) {
+            uint m = (n - start < BATCH) ? n - start : BATCH;
+            _findGroup(keys + start, m, found);
+            for (uint i=0; i<m; i++) {
+                results[start + i] = found[i] != 0;
             }
-        } else {
-            it.set(Entry(key, value));
         }
     }
     
+    /**
+     * Inserts n keys with their values, as if one at a time (so that,
+     * for repeated keys, the last value wins); prefetches like find_batch
+     */
+    void insert_batch(const KeyType* keys, const ValueType* values, uint n) {
+        uint64_t hashes[BATCH];
+        for (uint start=0; start<n; start+=BATCH) {
+            uint m = (n - start < BATCH) ? n - start : BATCH;
+            _prefetchGroup(keys + start, m, hashes);
+            for (uint i=0; i<m; i++) {
+                _insert(keys[start + i], values[start + i], hashes[i]);
+            }
+        }
+    }
+    
+    /** */
+    void insert(const KeyType& key, const ValueType& value) {
+        _insert(key, value, hash(key));
+    }
+    
     /** */
     void erase(const KeyType& key) {
-        Bin& bin = _bins[_binFor(key)];
-        BinIterator it = _findIn(bin, key);
+        _counters.erased();
+        uint64_t h = hash(key);
+        uint b = _binFor(h);
+        Bin& bin = _bins[b];
+        BinIterator it = _findIn(bin, key, h);
         if (it == bin.end()) {
             throw HashTableNoSuchElement("erase");
         } else {
             bin.erase(it);
+            if ( ! bin.size()) {
+                _unmark(b);
+            }
             _entryCount --;
+            if (_shrink && _size > INITIAL_SIZE 
+                    && _entryCount * MIN_LOAD_DIVISOR < _size) {
+                _resize(_size / 2);
+            }
         }
     }
     
+    /**
+     * Scans all bins to describe the table; usage counters are only
+     * available if compiled with EDA_HASHTABLE_STATS (see HashTableStats,
+     * also on how they affect concurrent lookups)
+     */
+    HashTableStats stats() const {
+        HashTableStats s = _counters.counts();
+        s.bins = _size;
+        s.entries = _entryCount;
+        s.loadFactor = (double)_entryCount / _size;
+        // each entry is in a list node, with two pointers
+        s.bytes = sizeof(HashTable) + _size * sizeof(Bin) 
+            + _words(_size) * sizeof(uint64_t)
+            + (ulong)_entryCount * (sizeof(Stored) + 2 * sizeof(void*));
+        double hitProbes = 0;
+        for (uint i=0; i<_size; i++) {
+            uint length = _bins[i].size();
+            s.longestChain = length > s.longestChain ? length : s.longestChain;
+            // finding each of the entries in a chain takes 1, 2, ... probes
+            hitProbes += length * (length + 1) / 2.0;
+        }
+        s.expectedHitProbes = _entryCount ? hitProbes / _entryCount : 0;
+        // a missing key's bin is random, and its chain is fully probed
+        s.expectedMissProbes = s.loadFactor;
+        return s;
+    }
+    
+    /** zeroes usage counters, to measure from now on */
+    void resetStats() {
+        _counters = HashTableCounters();
+    }
+    
     /** */
     void print(std::ostream &out=std::cout) {
         for (uint i=0; i<_size; i++) {
@@ -258,42 +595,190 @@ public:
     
 private:
 
-    uint _rehash(uint h) const {
-        // based on FastHash (https://code.google.com/p/fast-hash)
-        h ^= h >> 11;
-        h *= 4294967291; // large 32-bit prime
-        h ^= h >> 23;
-        return h;
+    /** hashes are well-mixed, so their lowest bits make a good index */
+    uint _binFor(uint64_t hash) const {
+        return (uint)hash & (_size - 1);
     }
     
-    int _binFor(const KeyType& key) const {
-        return _rehash(::hash(key)) % _size;
+    template <class Key>
+    Iterator _find(const Key& key) const {
+        _counters.found();
+        uint64_t h = hash(key);
+        Bin& bin = _bins[_binFor(h)];
+        const BinIterator& it = _findIn(bin, key, h);
+        return (it == bin.end()) ? end() 
+            : Iterator(this, &bin, it);
     }
     
-    BinIterator _findIn(const Bin& bin, const KeyType& key) const {
+    template <class Key>
+    ValueType& _at(const Key& key) const {
+        _counters.found();
+        uint64_t h = hash(key);
+        Bin& bin  = _bins[_binFor(h)];
+        BinIterator it = _findIn(bin, key, h);
+        if (it == bin.end()) {
+            throw HashTableNoSuchElement("at");
+        }
+        return it.elem()._value;
+    }
+    
+    /** inserts key, whose hash is h */
+    void _insert(const KeyType& key, const ValueType& value, uint64_t h) {
+        _counters.inserted();
+        uint b = _binFor(h);
+        Bin& bin  = _bins[b];
+        BinIterator it = _findIn(bin, key, h);
+        if (it == bin.end()) {
+            bin.push_back(Stored(key, value, h));
+            _mark(b);
+            _entryCount ++;
+            if (_entryCount / _size >= MAX_LOAD_FACTOR) {
+                _resize(_size * 2);
+            }
+        } else {
+            it.set(Stored(key, value, h));
+        }
+    }
+    
+    /**
+     * Hashes m keys (at most BATCH) into hashes; prefetches their bins,
+     * and then the first entry of each bin
+     */
+    void _prefetchGroup(const KeyType* keys, uint m, uint64_t* hashes) const {
+        for (uint i=0; i<m; i++) {
+            hashes[i] = hash(keys[i]);
+            EDA_PREFETCH(_bins + _binFor(hashes[i]));
+        }
+        for (uint i=0; i<m; i++) {
+            const Bin& bin = _bins[_binFor(hashes[i])];
+            if (bin.size()) {
+                EDA_PREFETCH(&bin.front());
+            }
+        }
+    }
+    
+    /**
+     * Finds m keys (at most BATCH); found[i] is 0 if keys[i] is missing.
+     * Walks all chains together, an entry at a time, prefetching the
+     * next entry of each
+     */
+    void _findGroup(const KeyType* keys, uint m, Stored** found) const {
+        uint64_t hashes[BATCH];
+        _prefetchGroup(keys, m, hashes);
+        BinIterator current[BATCH];
+        uint probes[BATCH];
+        uint active = 0;
+        for (uint i=0; i<m; i++) {
+            _counters.found();
+            current[i] = _bins[_binFor(hashes[i])].begin();
+            found[i] = 0;
+            probes[i] = 0;
+        }
+        const BinIterator end = _bins[0].end();
+        do {
+            active = 0;
+            for (uint i=0; i<m; i++) {
+                if (current[i] == end) {
+                    continue;
+                }
+                probes[i] ++;
+                if (current[i].elem().matches(keys[i], hashes[i])) {
+                    found[i] = &current[i].elem();
+                    current[i] = end;
+                    _counters.searched(probes[i], true);
+                    continue;
+                }
+                current[i].next();
+                if (current[i] != end) {
+                    EDA_PREFETCH(&current[i].elem());
+                    active ++;
+                } else {
+                    _counters.searched(probes[i], false);
+                }
+            }
+        } while (active);
+    }
+    
+    template <class Key>
+    BinIterator _findIn(const Bin& bin, const Key& key, uint64_t hash) const {
+        uint probes = 0;
         for (BinIterator it=bin.begin(); it!=bin.end(); it.next()) {
-            if (it.elem()._key == key) {
+            probes ++;
+            if (it.elem().matches(key, hash)) {
+                _counters.searched(probes, true);
                 return it;
             }
         }
+        _counters.searched(probes, false);
         return bin.end();
     }
     
-    void _grow() {
+    /** number of 64-bit words in a bitmap for 'bins' bins */
+    static uint _words(uint bins) {
+        return (bins + 63) / 64;
+    }
+    
+    void _mark(uint bin) {
+        _occupied[bin / 64] |= (uint64_t)1 << (bin % 64);
+    }
+    
+    void _unmark(uint bin) {
+        _occupied[bin / 64] &= ~((uint64_t)1 << (bin % 64));
+    }
+    
+    /** @return index of the first non-empty bin from 'from' on, or _size */
+    uint _nextOccupied(uint from) const {
+        uint w = from / 64;
+        const uint words = _words(_size);
+        if (w >= words) {
+            return _size;
+        }
+        uint64_t bits = _occupied[w] & (~(uint64_t)0 << (from % 64));
+        while ( ! bits) {
+            if (++ w == words) {
+                return _size;
+            }
+            bits = _occupied[w];
+        }
+        return w * 64 + _trailingZeros(bits);
+    }
+    
+    /** @return index of the lowest set bit of bits, which is not 0 */
+    static uint _trailingZeros(uint64_t bits) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(bits);
+#else
+        uint n = 0;
+        while ( ! (bits & 1)) {
+            bits >>= 1;
+            n ++;
+        }
+        return n;
+#endif
+    }
+    
+    /** moves all entries into a new set of 'size' bins */
+    void _resize(uint size) {
+        _counters.resizeStarted();
+        bool grew = size > _size;
         Bin allEntries;
-        for (uint i=0; i<_size; i++) {
+        for (uint i=_nextOccupied(0); i<_size; i=_nextOccupied(i + 1)) {
             allEntries.concat(_bins[i]);
         }
         delete[] _bins;
-        _size *= 2;
+        delete[] _occupied;
+        _size = size;
         _bins = new Bin[_size];
+        _occupied = new uint64_t[_words(_size)]();
         _entryCount = 0;
         while (allEntries.size()) {
-            const Entry& entry = allEntries.back();            
-            Bin& bin  = _bins[_binFor(entry._key)];
-            allEntries.moveBackTo(bin);
+            const Stored& entry = allEntries.back();            
+            uint b = _binFor(entry.hash());
+            allEntries.moveBackTo(_bins[b]);
+            _mark(b);
             _entryCount ++;
         }
+        _counters.resizeEnded(grew);
     }
 };
 
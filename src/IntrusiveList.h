@@ -0,0 +1,268 @@
+/**
+ * @file IntrusiveList.h
+ *
+ * An intrusive doubly-linked list: the links live inside the elements.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_INTRUSIVE_LIST_H
+#define EDA_INTRUSIVE_LIST_H
+
+#include "Util.h"
+
+DECLARE_EXCEPTION(IntrusiveListEmpty)
+DECLARE_EXCEPTION(IntrusiveListOutOfBounds)
+DECLARE_EXCEPTION(IntrusiveListAlreadyLinked)
+
+/**
+ * Link fields for an IntrusiveList. Embed one in each class whose
+ * objects you want to keep in such a list; use one hook per list
+ * that an object can simultaneously be in.
+ */
+struct ListHook {
+    ListHook* _prev;  ///< previous hook in list, 0 if not linked
+    ListHook* _next;  ///< next hook in list, 0 if not linked
+
+    ListHook() : _prev(0), _next(0) {}
+
+    /** copying an object must not copy its links */
+    ListHook(const ListHook&) : _prev(0), _next(0) {}
+
+    /** assigning to an object must not change its links */
+    ListHook& operator=(const ListHook&) {
+        return *this;
+    }
+
+    /** @return true if currently in a list */
+    bool linked() const {
+        return _next != 0;
+    }
+};
+
+/**
+ * An intrusive doubly-linked list. Elements are not copied: the list
+ * links the objects it is given through a ListHook member, and never
+ * allocates or frees anything. The caller owns the objects, and must
+ * keep them alive while they are in the list.
+ *
+ * For example, given
+ * <pre>
+ * struct Task { int id; ListHook _hook; };
+ * </pre>
+ * use an <code>IntrusiveList<Task, &Task::_hook></code>.
+ *
+ * All operations are O(1), including erasing an element given only
+ * a reference to it.
+ *
+ * @author mfreire
+ */
+template <class Type, ListHook Type::*Hook>
+class IntrusiveList {
+
+    ListHook _head;  ///< sentinel; _head._next is first, _head._prev last
+    uint _size;      ///< number of elements in list
+
+public:
+
+    /**  */
+    IntrusiveList() : _size(0) {
+        _head._prev = _head._next = &_head;
+    }
+
+    /** unlinks all elements (but does not free them) */
+    ~IntrusiveList() {
+        clear();
+    }
+
+    /**  */
+    uint size() const {
+        return _size;
+    }
+
+    class Iterator {
+    public:
+        void next() {
+            _current = _current->_next;
+        }
+
+        void prev() {
+            _current = _current->_prev;
+        }
+
+        Type& elem() const {
+            if (_current == _end) {
+                throw IntrusiveListOutOfBounds("elem");
+            }
+            return *ownerOf(_current, Hook);
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _current == other._current;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _current != other._current;
+        }
+    protected:
+        friend class IntrusiveList;
+
+        ListHook* _current;
+        const ListHook* _end;
+
+        Iterator(ListHook *h, const ListHook *end) : _current(h), _end(end) {}
+    };
+
+    /** */
+    Iterator begin() const {
+        return Iterator(_head._next, &_head);
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(const_cast<ListHook*>(&_head), &_head);
+    }
+
+    /**
+     * @return an iterator pointing to an element, which must be
+     * in this list. O(1)
+     */
+    Iterator iteratorTo(Type& e) const {
+        return Iterator(&(e.*Hook), &_head);
+    }
+
+    /**
+     * Links e before the given position,
+     * so that it->elem() will return 'e'
+     */
+    void insert(Iterator &it, Type& e) {
+        _link(it._current, e);
+        it.prev();
+    }
+
+    /** Unlinks the element at it, and advances it to the next one */
+    void erase(Iterator &it) {
+        if (it == end()) {
+            throw IntrusiveListOutOfBounds("erase");
+        }
+        ListHook *h = it._current;
+        it.next();
+        _unlink(h);
+    }
+
+    /**
+     * Unlinks an element, which must be in this list. O(1)
+     */
+    void erase(Type& e) {
+        if ( ! (e.*Hook).linked()) {
+            throw IntrusiveListOutOfBounds("erase");
+        }
+        _unlink(&(e.*Hook));
+    }
+
+    /**  */
+    void push_back(Type& e) {
+        _link(&_head, e);
+    }
+
+    /**  */
+    Type& back() const {
+        if (_size == 0) {
+            throw IntrusiveListEmpty("back");
+        }
+        return *ownerOf(_head._prev, Hook);
+    }
+
+    /**  */
+    void pop_back() {
+        if (_size == 0) {
+            throw IntrusiveListEmpty("pop_back");
+        }
+        _unlink(_head._prev);
+    }
+
+    /**  */
+    void push_front(Type& e) {
+        _link(_head._next, e);
+    }
+
+    /**  */
+    Type& front() const {
+        if (_size == 0) {
+            throw IntrusiveListEmpty("front");
+        }
+        return *ownerOf(_head._next, Hook);
+    }
+
+    /**  */
+    void pop_front() {
+        if (_size == 0) {
+            throw IntrusiveListEmpty("pop_front");
+        }
+        _unlink(_head._next);
+    }
+
+    /** unlinks all elements. O(n), since each hook is reset */
+    void clear() {
+        ListHook *h = _head._next;
+        while (h != &_head) {
+            ListHook *next = h->_next;
+            h->_prev = h->_next = 0;
+            h = next;
+        }
+        _head._prev = _head._next = &_head;
+        _size = 0;
+    }
+
+    /**
+     * Concatenates another list to the end of this one,
+     * emptying the other list in the process. O(1)
+     * @param other list to concatenate (will be emptied)
+     */
+    void concat(IntrusiveList& other) {
+        if (other._size == 0 || &other == this) {
+            return;
+        }
+        ListHook *f = other._head._next, *l = other._head._prev;
+        f->_prev = _head._prev;
+        _head._prev->_next = f;
+        l->_next = &_head;
+        _head._prev = l;
+        _size += other._size;
+        other._head._prev = other._head._next = &other._head;
+        other._size = 0;
+    }
+
+private:
+
+    // intrusive lists cannot be copied; their elements can only be in one
+    IntrusiveList(const IntrusiveList&);
+    IntrusiveList& operator=(const IntrusiveList&);
+
+    void _link(ListHook *next, Type& e) {
+        ListHook *h = &(e.*Hook);
+        if (h->linked()) {
+            throw IntrusiveListAlreadyLinked("link");
+        }
+        h->_next = next;
+        h->_prev = next->_prev;
+        next->_prev->_next = h;
+        next->_prev = h;
+        _size ++;
+    }
+
+    void _unlink(ListHook *h) {
+        h->_prev->_next = h->_next;
+        h->_next->_prev = h->_prev;
+        h->_prev = h->_next = 0;
+        _size --;
+    }
+};
+
+#endif // EDA_INTRUSIVE_LIST_H
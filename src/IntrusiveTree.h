@@ -0,0 +1,340 @@
+/**
+ * @file IntrusiveTree.h
+ *
+ * An intrusive sorted tree: the links live inside the elements.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_INTRUSIVE_TREE_H
+#define EDA_INTRUSIVE_TREE_H
+
+#include "Util.h"
+
+DECLARE_EXCEPTION(IntrusiveTreeEmpty)
+DECLARE_EXCEPTION(IntrusiveTreeOutOfBounds)
+DECLARE_EXCEPTION(IntrusiveTreeAlreadyLinked)
+
+/**
+ * Link fields for an IntrusiveTree. Embed one in each class whose
+ * objects you want to keep in such a tree.
+ */
+struct TreeHook {
+    TreeHook* _left;    ///< left (smaller) child, 0 if none
+    TreeHook* _right;   ///< right (larger or equal) child, 0 if none
+    TreeHook* _parent;  ///< parent, 0 if root or not linked
+    uint _priority;     ///< heap-ordered random priority; 0 if not linked
+
+    TreeHook() : _left(0), _right(0), _parent(0), _priority(0) {}
+
+    /** copying an object must not copy its links */
+    TreeHook(const TreeHook&) : _left(0), _right(0), _parent(0), _priority(0) {}
+
+    /** assigning to an object must not change its links */
+    TreeHook& operator=(const TreeHook&) {
+        return *this;
+    }
+
+    /** @return true if currently in a tree */
+    bool linked() const {
+        return _priority != 0;
+    }
+};
+
+/**
+ * An intrusive sorted tree. Elements are not copied: the tree links
+ * the objects it is given through a TreeHook member, and never allocates
+ * or frees anything. The caller owns the objects, and must keep them
+ * alive (and their keys unchanged) while they are in the tree.
+ *
+ * Elements are sorted using operator<; equivalent elements are allowed,
+ * and are kept in insertion order. Unlike TreeMap, the tree is kept
+ * balanced (as a treap: a search tree that is also a heap on random
+ * priorities), so insertion and lookup are O(log N) on average.
+ * Erasing an element given a reference to it requires no search,
+ * and access to the smallest element is O(1): this makes the tree
+ * suitable for schedulers and timer queues.
+ *
+ * @author mfreire
+ */
+template <class Type, TreeHook Type::*Hook>
+class IntrusiveTree {
+
+    TreeHook* _root;     ///< root of the tree, 0 if empty
+    TreeHook* _leftmost; ///< smallest element, 0 if empty
+    uint _size;          ///< number of elements in tree
+    uint _seed;          ///< state for priority generator
+
+public:
+
+    /**  */
+    IntrusiveTree() : _root(0), _leftmost(0), _size(0), _seed(2463534242u) {}
+
+    /** unlinks all elements (but does not free them) */
+    ~IntrusiveTree() {
+        clear();
+    }
+
+    /**  */
+    uint size() const {
+        return _size;
+    }
+
+    /**
+     * Iterates elements in ascending order
+     */
+    class Iterator {
+    public:
+        void next() {
+            if ( ! _current) {
+                throw IntrusiveTreeOutOfBounds("next");
+            }
+            _current = _successor(_current);
+        }
+
+        Type& elem() const {
+            if ( ! _current) {
+                throw IntrusiveTreeOutOfBounds("elem");
+            }
+            return *ownerOf(_current, Hook);
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _current == other._current;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _current != other._current;
+        }
+    protected:
+        friend class IntrusiveTree;
+
+        TreeHook* _current;
+
+        Iterator(TreeHook *h) : _current(h) {}
+    };
+
+    /** O(1) */
+    Iterator begin() const {
+        return Iterator(_leftmost);
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(0);
+    }
+
+    /**
+     * @return an iterator pointing to an element, which must be
+     * in this tree. O(1)
+     */
+    Iterator iteratorTo(Type& e) const {
+        return Iterator(&(e.*Hook));
+    }
+
+    /**
+     * @return an iterator to the first element that is not less than key;
+     * key can be of any type that can be compared to Type using operator<
+     */
+    template <class KeyType>
+    Iterator lower_bound(const KeyType& key) const {
+        TreeHook *n = _root, *found = 0;
+        while (n) {
+            if (_elem(n) < key) {
+                n = n->_right;
+            } else {
+                found = n;
+                n = n->_left;
+            }
+        }
+        return Iterator(found);
+    }
+
+    /**
+     * @return an iterator to the first element equivalent to key, or end()
+     */
+    template <class KeyType>
+    Iterator find(const KeyType& key) const {
+        Iterator it = lower_bound(key);
+        return (it._current && ! (key < _elem(it._current))) ? it : end();
+    }
+
+    /**  */
+    Type& front() const {
+        if (_size == 0) {
+            throw IntrusiveTreeEmpty("front");
+        }
+        return *ownerOf(_leftmost, Hook);
+    }
+
+    /** removes the smallest element */
+    void pop_front() {
+        if (_size == 0) {
+            throw IntrusiveTreeEmpty("pop_front");
+        }
+        _unlink(_leftmost);
+    }
+
+    /**
+     * Links an element into the tree. O(log N) on average
+     */
+    void insert(Type& e) {
+        TreeHook *h = &(e.*Hook);
+        if (h->linked()) {
+            throw IntrusiveTreeAlreadyLinked("insert");
+        }
+        _seed ^= _seed << 13;
+        _seed ^= _seed >> 17;
+        _seed ^= _seed << 5;
+        h->_priority = _seed | 1;
+        h->_left = h->_right = 0;
+
+        TreeHook *parent = 0, *n = _root;
+        bool left = false, smallest = true;
+        while (n) {
+            parent = n;
+            left = e < _elem(n);
+            if (left) {
+                n = n->_left;
+            } else {
+                n = n->_right;
+                smallest = false;
+            }
+        }
+        h->_parent = parent;
+        if ( ! parent) {
+            _root = h;
+        } else if (left) {
+            parent->_left = h;
+        } else {
+            parent->_right = h;
+        }
+        if (smallest) {
+            _leftmost = h;
+        }
+        while (h->_parent && h->_priority < h->_parent->_priority) {
+            _rotateUp(h);
+        }
+        _size ++;
+    }
+
+    /**
+     * Unlinks an element, which must be in this tree. Requires no search;
+     * O(log N) on average to restructure the tree.
+     */
+    void erase(Type& e) {
+        TreeHook *h = &(e.*Hook);
+        if ( ! h->linked()) {
+            throw IntrusiveTreeOutOfBounds("erase");
+        }
+        _unlink(h);
+    }
+
+    /** Unlinks the element at it, and advances it to the next one */
+    void erase(Iterator &it) {
+        if ( ! it._current) {
+            throw IntrusiveTreeOutOfBounds("erase");
+        }
+        TreeHook *h = it._current;
+        it.next();
+        _unlink(h);
+    }
+
+    /** unlinks all elements. O(n), since each hook is reset */
+    void clear() {
+        _clear(_root);
+        _root = _leftmost = 0;
+        _size = 0;
+    }
+
+private:
+
+    // intrusive trees cannot be copied; their elements can only be in one
+    IntrusiveTree(const IntrusiveTree&);
+    IntrusiveTree& operator=(const IntrusiveTree&);
+
+    static const Type& _elem(TreeHook *h) {
+        return *ownerOf(h, Hook);
+    }
+
+    static TreeHook* _successor(TreeHook *n) {
+        if (n->_right) {
+            n = n->_right;
+            while (n->_left) {
+                n = n->_left;
+            }
+            return n;
+        }
+        while (n->_parent && n->_parent->_right == n) {
+            n = n->_parent;
+        }
+        return n->_parent;
+    }
+
+    /** makes 'to' occupy the place of 'from' as a child of 'parent' */
+    void _replaceChild(TreeHook *parent, TreeHook *from, TreeHook *to) {
+        if ( ! parent) {
+            _root = to;
+        } else if (parent->_left == from) {
+            parent->_left = to;
+        } else {
+            parent->_right = to;
+        }
+        if (to) {
+            to->_parent = parent;
+        }
+    }
+
+    /** rotates n above its parent, preserving in-order sequence */
+    void _rotateUp(TreeHook *n) {
+        TreeHook *p = n->_parent;
+        _replaceChild(p->_parent, p, n);
+        if (p->_left == n) {
+            p->_left = n->_right;
+            if (n->_right) {
+                n->_right->_parent = p;
+            }
+            n->_right = p;
+        } else {
+            p->_right = n->_left;
+            if (n->_left) {
+                n->_left->_parent = p;
+            }
+            n->_left = p;
+        }
+        p->_parent = n;
+    }
+
+    void _unlink(TreeHook *h) {
+        if (h == _leftmost) {
+            _leftmost = _successor(h);
+        }
+        // sink h until it has at most one child
+        while (h->_left && h->_right) {
+            _rotateUp(h->_left->_priority < h->_right->_priority ?
+                h->_left : h->_right);
+        }
+        _replaceChild(h->_parent, h, h->_left ? h->_left : h->_right);
+        h->_left = h->_right = h->_parent = 0;
+        h->_priority = 0;
+        _size --;
+    }
+
+    static void _clear(TreeHook *n) {
+        while (n) {
+            _clear(n->_left);
+            TreeHook *right = n->_right;
+            n->_left = n->_right = n->_parent = 0;
+            n->_priority = 0;
+            n = right;
+        }
+    }
+};
+
+#endif // EDA_INTRUSIVE_TREE_H
@@ -0,0 +1,353 @@
+/**
+ * @file LRUCache.h
+ *
+ * Bounded caches, which evict entries as new ones come in:
+ * least-recently-used (LRU) and CLOCK.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_LRU_CACHE_H
+#define EDA_LRU_CACHE_H
+
+#include "Util.h"
+#include "Vector.h"
+#include "DoubleList.h"
+#include "HashTable.h"
+
+/**
+ * A map with a limited capacity: when full, adding an entry evicts the
+ * least-recently used ones (those that have gone longest without a get()
+ * or put()) to make room. Each entry has a weight (by default, 1);
+ * capacity limits the sum of the weights of all entries, and can
+ * therefore be a number of entries, or of bytes, or of any other unit.
+ *
+ * Entries are kept in a DoubleList, from most to least recently used,
+ * and a HashTable maps each key to its position in the list. A hit
+ * needs a single lookup, followed by an O(1) splice to the front of the
+ * list; get, put and erase are all O(1) (as long as the hash is good).
+ *
+ * @author mfreire
+ */
+template <class KeyType, class ValueType>
+class LRUCache {
+
+    /** a cached entry */
+    struct Item {
+        KeyType _key;
+        ValueType _value;
+        ulong _weight;
+
+        Item(const KeyType& key, const ValueType& value, ulong weight)
+            : _key(key), _value(value), _weight(weight) {}
+    };
+
+    typedef DoubleList<Item> List;
+    typedef typename List::Iterator ListIterator;
+
+    List _items;                          ///< most recently used first
+    HashTable<KeyType, ListIterator> _index; ///< key to position in _items
+    ulong _capacity;                      ///< maximum total weight
+    ulong _weight;                        ///< current total weight
+    ulong _hits;                          ///< successful get()s
+    ulong _misses;                        ///< failed get()s
+
+public:
+
+    /**
+     * @param capacity maximum total weight (by default, number of entries)
+     */
+    LRUCache(ulong capacity)
+        : _capacity(capacity), _weight(0), _hits(0), _misses(0) {}
+
+    /**
+     * Looks up a key, and marks its entry as most recently used.
+     * @return a pointer to its value (valid until the entry is evicted
+     * or erased), or 0 if not found
+     */
+    ValueType* get(const KeyType& key) {
+        typename HashTable<KeyType, ListIterator>::Iterator it = _index.find(key);
+        if (it == _index.end()) {
+            _misses ++;
+            return 0;
+        }
+        _hits ++;
+        ListIterator& pos = it.value();
+        _toFront(pos);
+        return &(pos.elem()._value);
+    }
+
+    /** @return true if key is cached; does not count as a use */
+    bool contains(const KeyType& key) const {
+        return _index.find(key) != _index.end();
+    }
+
+    /**
+     * Adds or replaces the entry for a key, as most recently used,
+     * evicting least-recently used entries as needed. Entries heavier
+     * than the whole capacity are not cached at all.
+     */
+    void put(const KeyType& key, const ValueType& value, ulong weight = 1) {
+        if (weight > _capacity) {
+            erase(key);
+            return;
+        }
+        typename HashTable<KeyType, ListIterator>::Iterator it = _index.find(key);
+        if (it != _index.end()) {
+            ListIterator& pos = it.value();
+            Item& item = pos.elem();
+            _weight = _weight - item._weight + weight;
+            item._value = value;
+            item._weight = weight;
+            _toFront(pos);
+        } else {
+            _items.push_front(Item(key, value, weight));
+            _index.insert(key, _items.begin());
+            _weight += weight;
+        }
+        _evict();
+    }
+
+    /**
+     * Removes the entry for a key
+     * @return false (and does nothing) if not cached
+     */
+    bool erase(const KeyType& key) {
+        typename HashTable<KeyType, ListIterator>::Iterator it = _index.find(key);
+        if (it == _index.end()) {
+            return false;
+        }
+        ListIterator pos = it.value();
+        _weight -= pos.elem()._weight;
+        _index.erase(key);
+        _items.erase(pos);
+        return true;
+    }
+
+    /** @return number of cached entries */
+    uint size() const {
+        return _items.size();
+    }
+
+    /** @return total weight of cached entries */
+    ulong weight() const {
+        return _weight;
+    }
+
+    /**  */
+    ulong capacity() const {
+        return _capacity;
+    }
+
+    /**  */
+    ulong hits() const {
+        return _hits;
+    }
+
+    /**  */
+    ulong misses() const {
+        return _misses;
+    }
+
+private:
+
+    // the index points into the list; copies would point into the original
+    LRUCache(const LRUCache&);
+    LRUCache& operator=(const LRUCache&);
+
+    void _toFront(const ListIterator& pos) {
+        if (pos == _items.begin()) {
+            return;
+        }
+        ListIterator next = pos;
+        next.next();
+        _items.splice(_items.begin(), _items, pos, next);
+    }
+
+    void _evict() {
+        while (_weight > _capacity) {
+            const Item& victim = _items.back();
+            _weight -= victim._weight;
+            _index.erase(victim._key);
+            _items.pop_back();
+        }
+    }
+};
+
+/**
+ * A bounded cache with the same interface as an LRUCache, but that
+ * approximates LRU with the CLOCK policy (F. J. Corbató, 1968): entries
+ * sit in a circular array of slots, each with a 'referenced' bit that
+ * get() sets (new entries start with it clear). To evict, a 'hand' sweeps
+ * the slots, clearing set bits, and evicts the first entry whose bit was
+ * already clear. Hits only set
+ * a bit, instead of relinking a list, and there are no per-entry
+ * allocations besides those of the HashTable; hit rates are usually
+ * close to those of LRU. KeyType and ValueType must have default
+ * constructors, to fill free slots.
+ *
+ * @author mfreire
+ */
+template <class KeyType, class ValueType>
+class ClockCache {
+
+    /** a slot, which may hold a cached entry */
+    struct Slot {
+        KeyType _key;
+        ValueType _value;
+        ulong _weight;
+        bool _used;         ///< false if free
+        bool _referenced;   ///< true if used since the hand last passed
+
+        Slot() : _key(), _value(), _weight(0), _used(false), _referenced(false) {}
+    };
+
+    Vector<Slot> _slots;               ///< all slots, used or not
+    Vector<uint> _free;                ///< indices of free slots
+    HashTable<KeyType, uint> _index;   ///< key to slot index
+    uint _hand;                        ///< next slot to consider for eviction
+    ulong _capacity;                   ///< maximum total weight
+    ulong _weight;                     ///< current total weight
+    ulong _hits;                       ///< successful get()s
+    ulong _misses;                     ///< failed get()s
+
+public:
+
+    /**
+     * @param capacity maximum total weight (by default, number of entries)
+     */
+    ClockCache(ulong capacity)
+        : _hand(0), _capacity(capacity), _weight(0), _hits(0), _misses(0) {}
+
+    /**
+     * Looks up a key, and marks its entry as referenced.
+     * @return a pointer to its value (valid until the entry is evicted
+     * or erased), or 0 if not found
+     */
+    ValueType* get(const KeyType& key) {
+        typename HashTable<KeyType, uint>::Iterator it = _index.find(key);
+        if (it == _index.end()) {
+            _misses ++;
+            return 0;
+        }
+        _hits ++;
+        Slot& s = _slots.at(it.value());
+        s._referenced = true;
+        return &s._value;
+    }
+
+    /** @return true if key is cached; does not count as a use */
+    bool contains(const KeyType& key) const {
+        return _index.find(key) != _index.end();
+    }
+
+    /**
+     * Adds or replaces the entry for a key, evicting entries as needed.
+     * Entries heavier than the whole capacity are not cached at all.
+     */
+    void put(const KeyType& key, const ValueType& value, ulong weight = 1) {
+        if (weight > _capacity) {
+            erase(key);
+            return;
+        }
+        typename HashTable<KeyType, uint>::Iterator it = _index.find(key);
+        uint i;
+        bool referenced = false;
+        if (it != _index.end()) {
+            i = it.value();
+            _weight -= _slots.at(i)._weight;
+            referenced = true;
+        } else {
+            if (_free.size()) {
+                i = _free.back();
+                _free.pop_back();
+            } else {
+                i = _slots.size();
+                _slots.push_back(Slot());
+            }
+            _index.insert(key, i);
+        }
+        Slot& s = _slots.at(i);
+        s._key = key;
+        s._value = value;
+        s._weight = weight;
+        s._used = true;
+        s._referenced = referenced;
+        _weight += weight;
+        _evict(i);
+    }
+
+    /**
+     * Removes the entry for a key
+     * @return false (and does nothing) if not cached
+     */
+    bool erase(const KeyType& key) {
+        typename HashTable<KeyType, uint>::Iterator it = _index.find(key);
+        if (it == _index.end()) {
+            return false;
+        }
+        _release(it.value());
+        return true;
+    }
+
+    /** @return number of cached entries */
+    uint size() const {
+        return _index.size();
+    }
+
+    /** @return total weight of cached entries */
+    ulong weight() const {
+        return _weight;
+    }
+
+    /**  */
+    ulong capacity() const {
+        return _capacity;
+    }
+
+    /**  */
+    ulong hits() const {
+        return _hits;
+    }
+
+    /**  */
+    ulong misses() const {
+        return _misses;
+    }
+
+private:
+
+    void _release(uint i) {
+        Slot& s = _slots.at(i);
+        _weight -= s._weight;
+        _index.erase(s._key);
+        s._used = false;
+        s._value = ValueType();
+        _free.push_back(i);
+    }
+
+    /**
+     * Sweeps the hand until enough weight is evicted; takes at most two
+     * turns, since the first one clears all referenced bits
+     * @param keep slot that must not be evicted (the one just put)
+     */
+    void _evict(uint keep) {
+        while (_weight > _capacity) {
+            Slot& s = _slots.at(_hand);
+            if (s._used && s._referenced) {
+                s._referenced = false;
+            } else if (s._used && _hand != keep) {
+                _release(_hand);
+            }
+            _hand = (_hand + 1 == _slots.size()) ? 0 : _hand + 1;
+        }
+    }
+};
+
+#endif // EDA_LRU_CACHE_H
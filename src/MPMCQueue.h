@@ -0,0 +1,187 @@
+/**
+ * @file MPMCQueue.h
+ *
+ * A bounded lock-free queue for many producers and many consumers.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_MPMC_QUEUE_H
+#define EDA_MPMC_QUEUE_H
+
+#include <atomic>
+#include <thread>
+#include <cstddef>
+
+#include "Util.h"
+
+DECLARE_EXCEPTION(MPMCQueueInvalidCapacity)
+
+/**
+ * A fixed-capacity first-in, first-out queue that can be shared, without
+ * locks, by any number of producer and consumer threads. Offers the same
+ * push/pop operations as a Queue, but pop() hands back the popped element
+ * through its argument (front() cannot be safely exposed when others may
+ * pop concurrently).
+ *
+ * Based on Dmitry Vyukov's bounded MPMC queue: each slot in a circular
+ * buffer carries a sequence number that says whether it is ready to be
+ * written (seq == position) or read (seq == position + 1). Producers
+ * and consumers claim positions with a compare-and-swap on their own
+ * counter, so they only contend with others on the same side, and never
+ * with each other unless the queue is nearly full or empty.
+ *
+ * try_push and try_pop never block. push and pop spin for a short while,
+ * and then yield the processor, until they succeed.
+ *
+ * @author mfreire
+ */
+template <class Type>
+class MPMCQueue {
+
+    /** a slot in the buffer */
+    struct Cell {
+        std::atomic<size_t> _seq;  ///< sequence number, see above
+        Type _elem;                ///< element stored in the slot
+    };
+
+    /// spins before yielding in push and pop
+    static const uint SPINS_BEFORE_YIELD = 64;
+
+    char _pad0[EDA_CACHE_LINE];
+    Cell* _v;     ///< dynamically-reserved array of cells
+    size_t _mask; ///< number of cells in _v, minus one
+
+    char _pad1[EDA_CACHE_LINE];
+    std::atomic<size_t> _end;   ///< next position to push into
+
+    char _pad2[EDA_CACHE_LINE];
+    std::atomic<size_t> _start; ///< next position to pop from
+
+    char _pad3[EDA_CACHE_LINE];
+
+public:
+
+    /**
+     * @param capacity minimal capacity; will be rounded up to
+     * the next power of two (and to at least 2)
+     */
+    MPMCQueue(uint capacity) {
+        if (capacity == 0 || capacity > (1u << 31)) {
+            throw MPMCQueueInvalidCapacity("MPMCQueue");
+        }
+        size_t max = 2;
+        while (max < capacity) {
+            max *= 2;
+        }
+        _mask = max - 1;
+        _v = new Cell[max];
+        for (size_t i=0; i<max; i++) {
+            _v[i]._seq.store(i, std::memory_order_relaxed);
+        }
+        _start.store(0, std::memory_order_relaxed);
+        _end.store(0, std::memory_order_relaxed);
+    }
+
+    /**  */
+    ~MPMCQueue() {
+        delete[] _v;
+        _v = 0;
+    }
+
+    /**  */
+    uint capacity() const {
+        return (uint)(_mask + 1);
+    }
+
+    /**
+     * @return number of elements. Only exact if no other thread is
+     * concurrently modifying the queue
+     */
+    uint size() const {
+        size_t start = _start.load(std::memory_order_acquire);
+        size_t end = _end.load(std::memory_order_acquire);
+        return (end > start) ? (uint)(end - start) : 0;
+    }
+
+    /**
+     * @return false (and does nothing) if the queue was full
+     */
+    bool try_push(const Type& e) {
+        size_t pos = _end.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = _v[pos & _mask];
+            size_t seq = cell._seq.load(std::memory_order_acquire);
+            ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+            if (diff == 0) {
+                if (_end.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    cell._elem = e;
+                    cell._seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+                // failed CAS reloads pos; try again
+            } else if (diff < 0) {
+                return false; // still holds an element from a lap ago
+            } else {
+                pos = _end.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @return false (and does nothing) if the queue was empty
+     */
+    bool try_pop(Type& e) {
+        size_t pos = _start.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = _v[pos & _mask];
+            size_t seq = cell._seq.load(std::memory_order_acquire);
+            ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+            if (diff == 0) {
+                if (_start.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    e = cell._elem;
+                    cell._seq.store(pos + _mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // not yet written
+            } else {
+                pos = _start.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** pushes e, waiting for a free slot if the queue is full */
+    void push(const Type& e) {
+        for (uint spins = 0; ! try_push(e); spins ++) {
+            if (spins >= SPINS_BEFORE_YIELD) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /** pops into e, waiting for an element if the queue is empty */
+    void pop(Type& e) {
+        for (uint spins = 0; ! try_pop(e); spins ++) {
+            if (spins >= SPINS_BEFORE_YIELD) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+
+    // queues are shared by reference; copying one makes no sense
+    MPMCQueue(const MPMCQueue&);
+    MPMCQueue& operator=(const MPMCQueue&);
+};
+
+#endif // EDA_MPMC_QUEUE_H
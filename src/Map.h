@@ -64,15 +64,61 @@ public:
         return _m.at(key);
     }
     
+    /**
+     * Looks up a key of another type; without converting it, if
+     * a TransparentKey of KeyType (see Util.h)
+     */
+    template <class Other>
+    const ValueType& at(const Other& key) const {
+        return _m.at(key);
+    }
+    
+    /** */
+    template <class Other>
+    ValueType& at(const Other& key) {
+        return _m.at(key);
+    }
+    
     /**  */
     bool contains(const KeyType& key) const {
-        return _m.find(key) != _m.end();
+        return _m.contains(key);
+    }
+    
+    /**
+     * Looks up a key of another type; without converting it, if
+     * a TransparentKey of KeyType (see Util.h)
+     */
+    template <class Other>
+    bool contains(const Other& key) const {
+        return _m.contains(key);
+    }
+    
+    /**
+     * Looks up n keys at once; faster than one by one in large maps
+     * @param values set to a pointer to the value of each key, or to 0 if
+     * not found; pointers are valid until the map changes
+     */
+    void find_batch(const KeyType* keys, uint n, ValueType** values) {
+        _m.find_batch(keys, n, values);
+    }
+    
+    /**
+     * Looks up n keys at once; faster than one by one in large maps
+     * @param results set to whether each key is in the map
+     */
+    void contains_batch(const KeyType* keys, uint n, bool* results) const {
+        _m.contains_batch(keys, n, results);
     }
     
     /**  */
     void insert(const KeyType& key, const ValueType& value) {
         _m.insert(key, value);
     }
+    
+    /** inserts n keys with their values, as if one at a time */
+    void insert_batch(const KeyType* keys, const ValueType* values, uint n) {
+        _m.insert_batch(keys, values, n);
+    }
 
     /**  */
     void erase(const KeyType& key) {
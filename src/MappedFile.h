@@ -0,0 +1,239 @@
+/**
+ * @file MappedFile.h
+ *
+ * Files mapped into memory, and files written under a temporary name.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_MAPPED_FILE_H
+#define EDA_MAPPED_FILE_H
+
+#include <string>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Util.h"
+
+/**
+ * A whole file, mapped read-only into memory, and unmapped when closed
+ * or destroyed. The mapping stays valid even if the file is later
+ * replaced (renamed over) or removed. Used by file-backed containers,
+ * which throw their own IOError type. Needs POSIX (for mmap).
+ *
+ * @author mfreire
+ */
+template <class IOError>
+class MappedFile {
+
+    void* _map;     ///< start of the mapping, or 0 if none
+    size_t _size;   ///< bytes mapped
+
+public:
+
+    /** nothing mapped, to open() a file later */
+    MappedFile() : _map(0), _size(0) {}
+
+    /**
+     * Maps a file
+     * @throws IOError if it cannot be opened or mapped
+     */
+    explicit MappedFile(const std::string& path) : _map(0), _size(0) {
+        open(path);
+    }
+
+    /** unmaps the file */
+    ~MappedFile() {
+        close();
+    }
+
+    /**
+     * Maps a file, replacing any file already mapped; empty files are
+     * not mapped, and have no data()
+     * @throws IOError if it cannot be opened or mapped
+     */
+    void open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw IOError(path + ": " + strerror(errno));
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            std::string error = strerror(errno);
+            ::close(fd);
+            throw IOError(path + ": " + error);
+        }
+        if (st.st_size == 0) {
+            ::close(fd);
+            return;
+        }
+        void* map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            throw IOError(path + ": " + strerror(errno));
+        }
+        _map = map;
+        _size = st.st_size;
+    }
+
+    /** unmaps the file, if any */
+    void close() {
+        if (_map) {
+            munmap(_map, _size);
+        }
+        _map = 0;
+        _size = 0;
+    }
+
+    /** exchanges mappings with another MappedFile */
+    void swap(MappedFile& other) {
+        std::swap(_map, other._map);
+        std::swap(_size, other._size);
+    }
+
+    /** @return the first byte of the file, or 0 if none mapped */
+    const char* data() const {
+        return (const char*)_map;
+    }
+
+    /** @return bytes mapped */
+    size_t size() const {
+        return _size;
+    }
+
+private:
+
+    // a mapping can only be unmapped once
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+/**
+ * A file that is written under a temporary name (its path plus ".tmp"),
+ * and only renamed to its path by commit(): readers never see it
+ * half-written, and a previous file with that path stays readable until
+ * then. It is removed if destroyed before commit(), or after an error.
+ *
+ * @author mfreire
+ */
+template <class IOError>
+class TempFile {
+
+    std::string _path;   ///< final name
+    std::string _temp;   ///< name while being written
+    int _fd;             ///< -1 once committed or failed
+
+public:
+
+    /**
+     * Creates (or truncates) the temporary file
+     * @throws IOError if it cannot be created
+     */
+    explicit TempFile(const std::string& path)
+            : _path(path), _temp(path + ".tmp"), _fd(-1) {
+        _fd = ::open(_temp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (_fd < 0) {
+            throw IOError(_temp + ": " + strerror(errno));
+        }
+    }
+
+    /** removes the temporary file, unless committed */
+    ~TempFile() {
+        _discard();
+    }
+
+    /** @return false once committed, or after an error */
+    bool isOpen() const {
+        return _fd >= 0;
+    }
+
+    /** @return its file descriptor, to write it directly */
+    int fd() const {
+        return _fd;
+    }
+
+    /**
+     * Appends size bytes
+     * @throws IOError if they cannot be written
+     */
+    void write(const void* data, size_t size) {
+        const char* p = (const char*)data;
+        while (size) {
+            ssize_t written = ::write(_fd, p, size);
+            if (written < 0 && errno != EINTR) {
+                fail();
+            }
+            if (written > 0) {
+                p += written;
+                size -= written;
+            }
+        }
+    }
+
+    /**
+     * Overwrites size bytes, starting at offset
+     * @throws IOError if they cannot be written
+     */
+    void writeAt(uint64_t offset, const void* data, size_t size) {
+        if (pwrite(_fd, data, size, offset) != (ssize_t)size) {
+            fail();
+        }
+    }
+
+    /**
+     * Removes the temporary file, and throws an IOError that describes
+     * the last failed call (as found in errno)
+     */
+    void fail() {
+        std::string error = strerror(errno);
+        _discard();
+        throw IOError(_temp + ": " + error);
+    }
+
+    /**
+     * Flushes the file to disk, and renames it to its final path
+     * @throws IOError if it cannot be flushed or renamed
+     */
+    void commit() {
+        if (fsync(_fd) != 0) {
+            fail();
+        }
+        int closed = ::close(_fd);
+        _fd = -1;
+        if (closed != 0 || rename(_temp.c_str(), _path.c_str()) != 0) {
+            std::string error = strerror(errno);
+            unlink(_temp.c_str());
+            throw IOError(_path + ": " + error);
+        }
+    }
+
+private:
+
+    // only one owner can commit or remove it
+    TempFile(const TempFile&);
+    TempFile& operator=(const TempFile&);
+
+    void _discard() {
+        if (_fd >= 0) {
+            ::close(_fd);
+            unlink(_temp.c_str());
+        }
+        _fd = -1;
+    }
+};
+
+#endif // EDA_MAPPED_FILE_H
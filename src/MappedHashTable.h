@@ -0,0 +1,364 @@
+/**
+ * @file MappedHashTable.h
+ *
+ * A read-only hash table stored in a file, and used straight from it.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_MAPPED_HASHTABLE_H
+#define EDA_MAPPED_HASHTABLE_H
+
+#include <string>
+#include <cstring>
+#include <sys/mman.h>
+#if __cplusplus >= 201103L
+#include <type_traits>
+#endif
+
+#include "MapEntry.h"
+#include "MappedFile.h"
+#include "Hash.h"
+#include "Util.h"
+
+DECLARE_EXCEPTION(MappedHashTableNoSuchElement)
+DECLARE_EXCEPTION(MappedHashTableIOError)
+DECLARE_EXCEPTION(MappedHashTableBadFile)
+
+/**
+ * Start of a MappedHashTable file. All offsets are in bytes from the start
+ * of the file, so that it can be mapped at any address.
+ */
+struct MappedHashTableHeader {
+    char magic[8];          ///< "EDAHASH" and a 0
+    uint32_t version;       ///< of the file format
+    uint32_t byteOrder;     ///< 0x01020304, as written by the writer
+    uint32_t keySize;       ///< sizeof(KeyType)
+    uint32_t entrySize;     ///< sizeof(MapEntry<KeyType, ValueType>)
+    uint64_t entries;       ///< number of entries
+    uint64_t bins;          ///< number of bins; a power of 2
+    uint64_t binsOffset;    ///< of bins + 1 uint32_t, where each bin starts
+    uint64_t entriesOffset; ///< of the entries, sorted by bin
+    uint64_t fileSize;      ///< in bytes
+};
+
+/**
+ * A hash table that lives in a file, and is looked up directly from
+ * memory-mapped pages: opening one takes constant time, no matter its
+ * size, as pages are only read from disk (or from the page cache, where
+ * they can be shared by several processes) as lookups touch them. Build
+ * files with write(), from a HashTable or any other map.
+ *
+ * The layout is that of a HashTable whose bins are packed one after the
+ * other ("compressed sparse rows"): after a MappedHashTableHeader comes an
+ * array with the offset of the first entry of each bin, and then all the
+ * entries, sorted by bin, as MapEntry structs. A lookup reads two
+ * consecutive offsets and then the (usually 1 or 2) entries of its bin.
+ *
+ * KeyType and ValueType must be trivially copyable (no pointers, no
+ * std::strings), as entries are stored and read as raw bytes. Files can
+ * only be read on machines with the same byte order and struct layout,
+ * and with the same hash functions, as those that wrote them; open()
+ * checks what it can, and throws MappedHashTableBadFile on mismatches;
+ * lookups also throw it if they find a corrupt bin.
+ * Needs POSIX (for mmap).
+ *
+ * @author mfreire
+ */
+template <class KeyType, class ValueType>
+class MappedHashTable {
+public:
+
+    /** */
+    typedef MapEntry<KeyType, ValueType> Entry;
+
+private:
+
+#if __cplusplus >= 201103L
+    static_assert(std::is_trivially_copyable<KeyType>::value
+                  && std::is_trivially_copyable<ValueType>::value,
+                  "MappedHashTable needs trivially copyable keys and values");
+#endif
+
+    /** current file format */
+    static const uint32_t VERSION = 1;
+
+    /** at most one entry per bin, on average */
+    static const uint MAX_LOAD_FACTOR = 1;
+
+    /** most bins a table can have; larger ones have more entries per bin */
+    static const uint MAX_BINS = 1u << 31;
+
+    MappedFile<MappedHashTableIOError> _file; ///< the whole file
+    const uint32_t* _bins;   ///< start of each bin, plus the end of the last
+    const Entry* _entries;   ///< sorted by bin
+    uint _size;              ///< number of entries
+    uint _binCount;          ///< a power of 2
+
+public:
+
+    /** an empty table, to open() a file later */
+    MappedHashTable() : _bins(0), _entries(0), _size(0), _binCount(0) {}
+
+    /**
+     * Maps a file built with write()
+     * @throws MappedHashTableIOError if it cannot be opened or mapped
+     * @throws MappedHashTableBadFile if it was not written by a
+     *   MappedHashTable with the same types, on a similar machine
+     */
+    explicit MappedHashTable(const std::string& path)
+            : _bins(0), _entries(0), _size(0), _binCount(0) {
+        open(path);
+    }
+
+    /** unmaps the file */
+    ~MappedHashTable() {
+        close();
+    }
+
+    /**
+     * Maps a file built with write(), replacing any file already mapped.
+     * Takes constant time: nothing beyond the header is read until needed
+     */
+    void open(const std::string& path) {
+        close();
+        MappedFile<MappedHashTableIOError> file(path);
+        if (file.size() < sizeof(MappedHashTableHeader)) {
+            throw MappedHashTableBadFile(path + ": too short");
+        }
+        const MappedHashTableHeader& h = *(const MappedHashTableHeader*)file.data();
+        const char* problem = _check(h, file.size());
+        if (problem) {
+            throw MappedHashTableBadFile(path + ": " + problem);
+        }
+        _file.swap(file);
+        _bins = (const uint32_t*)(_file.data() + h.binsOffset);
+        _entries = (const Entry*)(_file.data() + h.entriesOffset);
+        _size = (uint)h.entries;
+        _binCount = (uint)h.bins;
+    }
+
+    /** unmaps the file, if any, and leaves the table empty */
+    void close() {
+        _file.close();
+        _bins = 0;
+        _entries = 0;
+        _size = _binCount = 0;
+    }
+
+    /**
+     * Writes the entries of a map (such as a HashTable, or a Map::H) to
+     * a file that can then be opened as a MappedHashTable. The file is
+     * written under a temporary name and then renamed, so that processes
+     * that open it never see it half-written.
+     * @throws MappedHashTableIOError if the file cannot be written
+     */
+    template <class Map>
+    static void write(const Map& map, const std::string& path) {
+        uint n = map.size();
+        uint bins = 1;
+        while (bins < MAX_BINS && (uint64_t)bins * MAX_LOAD_FACTOR < n) {
+            bins *= 2;
+        }
+        MappedHashTableHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "EDAHASH", 8);
+        h.version = VERSION;
+        h.byteOrder = 0x01020304;
+        h.keySize = sizeof(KeyType);
+        h.entrySize = sizeof(Entry);
+        h.entries = n;
+        h.bins = bins;
+        h.binsOffset = sizeof(MappedHashTableHeader);
+        h.entriesOffset = _align(h.binsOffset + (bins + 1) * sizeof(uint32_t));
+        h.fileSize = h.entriesOffset + (uint64_t)n * sizeof(Entry);
+
+        TempFile<MappedHashTableIOError> file(path);
+        if (ftruncate(file.fd(), h.fileSize) != 0) {
+            file.fail();
+        }
+        char* out = (char*)mmap(0, h.fileSize, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, file.fd(), 0);
+        if (out == MAP_FAILED) {
+            file.fail();
+        }
+        memcpy(out, &h, sizeof(h));
+        uint32_t* start = (uint32_t*)(out + h.binsOffset);
+        Entry* entries = (Entry*)(out + h.entriesOffset);
+
+        // counting sort by bin: count, accumulate, and place
+        for (typename Map::Iterator it = map.begin(); it != map.end(); it.next()) {
+            start[_binFor(it.key(), bins) + 1] ++;
+        }
+        for (uint b=0; b<bins; b++) {
+            start[b + 1] += start[b];
+        }
+        for (typename Map::Iterator it = map.begin(); it != map.end(); it.next()) {
+            // start[b] advances as bin b fills, ending at start[b + 1]
+            uint32_t& next = start[_binFor(it.key(), bins)];
+            entries[next ++] = Entry(it.key(), it.value());
+        }
+        // and back, so that start[b] is where bin b starts
+        for (uint b=bins; b>0; b--) {
+            start[b] = start[b - 1];
+        }
+        start[0] = 0;
+
+        bool synced = msync(out, h.fileSize, MS_SYNC) == 0;
+        munmap(out, h.fileSize);
+        if ( ! synced) {
+            file.fail();
+        }
+        file.commit();
+    }
+
+    /** */
+    uint size() const {
+        return _size;
+    }
+
+    /** @return bytes of the mapped file, whether paged in or not */
+    ulong bytes() const {
+        return _file.size();
+    }
+
+    class Iterator {
+    public:
+        void next() {
+            _current ++;
+        }
+
+        const Entry& elem() const {
+            return *_current;
+        }
+
+        const ValueType& value() const {
+            return _current->_value;
+        }
+
+        const KeyType& key() const {
+            return _current->_key;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _current == other._current;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _current != other._current;
+        }
+    protected:
+        friend class MappedHashTable;
+
+        const Entry* _current;
+
+        Iterator(const Entry* current) : _current(current) {}
+    };
+
+    /** iterates entries in file order, which is that of their bins */
+    Iterator begin() const {
+        return Iterator(_entries);
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(_entries + _size);
+    }
+
+    /** */
+    Iterator find(const KeyType& key) const {
+        const Entry* e = _find(key);
+        return e ? Iterator(e) : end();
+    }
+
+    /** */
+    const ValueType& at(const KeyType& key) const {
+        const Entry* e = _find(key);
+        if ( ! e) {
+            throw MappedHashTableNoSuchElement("at");
+        }
+        return e->_value;
+    }
+
+    /** */
+    bool contains(const KeyType& key) const {
+        return _find(key) != 0;
+    }
+
+private:
+
+    MappedHashTable(const MappedHashTable&);
+    MappedHashTable& operator=(const MappedHashTable&);
+
+    static uint _binFor(const KeyType& key, uint bins) {
+        return hash(key) & (bins - 1);
+    }
+
+    /** @return offset rounded up to a multiple of 64, a cache line */
+    static uint64_t _align(uint64_t offset) {
+        return (offset + 63) & ~(uint64_t)63;
+    }
+
+    /** @return what is wrong with a header, or 0 if nothing */
+    static const char* _check(const MappedHashTableHeader& h, ulong fileSize) {
+        if (memcmp(h.magic, "EDAHASH", 8) != 0) {
+            return "not a MappedHashTable";
+        }
+        if (h.version != VERSION) {
+            return "unsupported version";
+        }
+        if (h.byteOrder != 0x01020304) {
+            return "written with another byte order";
+        }
+        if (h.keySize != sizeof(KeyType) || h.entrySize != sizeof(Entry)) {
+            return "written with other key or value types";
+        }
+        if (h.bins == 0 || (h.bins & (h.bins - 1)) != 0 || h.bins > MAX_BINS
+                || h.entries > 0xffffffffULL
+                || h.fileSize != fileSize
+                || h.binsOffset < sizeof(MappedHashTableHeader)
+                || h.binsOffset % sizeof(uint32_t) != 0
+                || h.binsOffset > h.entriesOffset
+                || h.binsOffset + (h.bins + 1) * sizeof(uint32_t) > h.entriesOffset
+                || h.entriesOffset % 64 != 0
+                || h.entriesOffset > fileSize
+                || h.entriesOffset + h.entries * sizeof(Entry) != fileSize) {
+            return "corrupt header";
+        }
+        // the header is the start of the mapping; bins follow it
+        const uint32_t* bins = (const uint32_t*)((const char*)&h + h.binsOffset);
+        if (bins[0] != 0 || bins[h.bins] != h.entries) {
+            return "corrupt bins";
+        }
+        return 0;
+    }
+
+    /** @throws MappedHashTableBadFile if the bin of key is corrupt */
+    const Entry* _find(const KeyType& key) const {
+        if (_size == 0) {
+            return 0;
+        }
+        uint b = _binFor(key, _binCount);
+        uint32_t first = _bins[b], end = _bins[b + 1];
+        // open() only checks the first and last bins: checking all would
+        // read the whole array
+        if (first > end || end > _size) {
+            throw MappedHashTableBadFile("corrupt bins");
+        }
+        const Entry* last = _entries + end;
+        for (const Entry* e = _entries + first; e != last; e++) {
+            if (e->_key == key) {
+                return e;
+            }
+        }
+        return 0;
+    }
+};
+
+#endif // EDA_MAPPED_HASHTABLE_H
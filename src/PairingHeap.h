@@ -0,0 +1,292 @@
+/**
+ * @file PairingHeap.h
+ *
+ * An addressable priority queue (pairing heap).
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_PAIRING_HEAP_H
+#define EDA_PAIRING_HEAP_H
+
+#include "Util.h"
+#include "Vector.h"
+
+DECLARE_EXCEPTION(PairingHeapEmpty)
+DECLARE_EXCEPTION(PairingHeapInvalidKey)
+
+/**
+ * A priority queue where elements can be changed or removed after being
+ * pushed: push() returns a Handle to the element, which remains valid
+ * until the element is popped or erased (even if its heap is melded into
+ * another). As in a PriorityQueue, top() is always the first element
+ * according to Compare (by default, the smallest one).
+ *
+ * Implemented as a pairing heap (Fredman, Sedgewick, Sleator and Tarjan,
+ * 1986): a tree where each node comes before all its children, with
+ * children kept in a doubly-linked list. push, top, meld and
+ * decrease_key are O(1); pop, erase and increase_key are O(log n)
+ * amortized. In practice, one of the fastest heaps for algorithms such as
+ * Dijkstra's, which would otherwise have to push duplicates.
+ *
+ * @author mfreire
+ */
+template <class Type, class Compare = Less<Type> >
+class PairingHeap {
+
+    /** */
+    struct Node {
+        Type _elem;    ///< actual element
+        Node* _child;  ///< first child, 0 if none
+        Node* _next;   ///< next sibling, 0 if none
+        Node* _prev;   ///< previous sibling; parent if first child
+
+        Node(const Type& e) : _elem(e), _child(0), _next(0), _prev(0) {}
+    };
+
+    Node* _root;     ///< first element; 0 if empty
+    uint _size;      ///< number of elements
+    Compare _before; ///< comparison
+
+public:
+
+    /**
+     * Identifies an element in a heap
+     */
+    class Handle {
+    public:
+        Handle() : _node(0) {}
+
+        const Type& elem() const {
+            return _node->_elem;
+        }
+
+        bool operator==(const Handle &other) const {
+            return _node == other._node;
+        }
+
+        bool operator!=(const Handle &other) const {
+            return _node != other._node;
+        }
+    protected:
+        friend class PairingHeap;
+
+        Node* _node;
+
+        Handle(Node* node) : _node(node) {}
+    };
+
+    /**  */
+    PairingHeap(const Compare& before = Compare())
+        : _root(0), _size(0), _before(before) {}
+
+    /**  */
+    ~PairingHeap() {
+        _clear();
+    }
+
+    /**  */
+    uint size() const {
+        return _size;
+    }
+
+    /** @return a handle to the new element */
+    Handle push(const Type& e) {
+        Node* n = new Node(e);
+        _root = _meld(_root, n);
+        _size ++;
+        return Handle(n);
+    }
+
+    /**  */
+    const Type& top() const {
+        if ( ! _root) {
+            throw PairingHeapEmpty("top");
+        }
+        return _root->_elem;
+    }
+
+    /**  */
+    Handle topHandle() const {
+        if ( ! _root) {
+            throw PairingHeapEmpty("topHandle");
+        }
+        return Handle(_root);
+    }
+
+    /**  */
+    void pop() {
+        if ( ! _root) {
+            throw PairingHeapEmpty("pop");
+        }
+        erase(Handle(_root));
+    }
+
+    /**
+     * Removes the element of h, which must be in this heap;
+     * h (and any copies of it) become invalid
+     */
+    void erase(const Handle& h) {
+        Node* n = h._node;
+        Node* children = _detachChildren(n);
+        if (n == _root) {
+            _root = _combine(children);
+        } else {
+            _cut(n);
+            _root = _meld(_root, _combine(children));
+        }
+        delete n;
+        _size --;
+    }
+
+    /**
+     * Replaces the element of h by e, which must not come after it. O(1)
+     */
+    void decrease_key(const Handle& h, const Type& e) {
+        Node* n = h._node;
+        if (_before(n->_elem, e)) {
+            throw PairingHeapInvalidKey("decrease_key");
+        }
+        n->_elem = e;
+        if (n != _root) {
+            _cut(n);
+            _root = _meld(_root, n);
+        }
+    }
+
+    /**
+     * Replaces the element of h by e, which must not come before it
+     */
+    void increase_key(const Handle& h, const Type& e) {
+        Node* n = h._node;
+        if (_before(e, n->_elem)) {
+            throw PairingHeapInvalidKey("increase_key");
+        }
+        n->_elem = e;
+        Node* children = _combine(_detachChildren(n));
+        if (n == _root) {
+            _root = 0;
+        } else {
+            _cut(n);
+        }
+        _root = _meld(_meld(_root, children), n);
+    }
+
+    /**
+     * Moves all elements of other into this heap, in O(1);
+     * their handles remain valid, but now refer to this heap
+     */
+    void meld(PairingHeap& other) {
+        if (&other != this) {
+            _root = _meld(_root, other._root);
+            _size += other._size;
+            other._root = 0;
+            other._size = 0;
+        }
+    }
+
+private:
+
+    // handles point into the heap; copying one makes no sense
+    PairingHeap(const PairingHeap&);
+    PairingHeap& operator=(const PairingHeap&);
+
+    /** links two roots (either may be 0); returns the new root */
+    Node* _meld(Node* a, Node* b) {
+        if ( ! a) {
+            return b;
+        } else if ( ! b) {
+            return a;
+        }
+        if (_before(b->_elem, a->_elem)) {
+            Node* t = a;
+            a = b;
+            b = t;
+        }
+        b->_next = a->_child;
+        if (a->_child) {
+            a->_child->_prev = b;
+        }
+        b->_prev = a;
+        a->_child = b;
+        return a;
+    }
+
+    /** unlinks n (which is not the root) from its parent and siblings */
+    static void _cut(Node* n) {
+        if (n->_prev->_child == n) {
+            n->_prev->_child = n->_next;
+        } else {
+            n->_prev->_next = n->_next;
+        }
+        if (n->_next) {
+            n->_next->_prev = n->_prev;
+        }
+        n->_prev = n->_next = 0;
+    }
+
+    /** @return the first of n's children, which are no longer its own */
+    static Node* _detachChildren(Node* n) {
+        Node* first = n->_child;
+        n->_child = 0;
+        if (first) {
+            first->_prev = 0;
+        }
+        return first;
+    }
+
+    /**
+     * Combines a list of siblings into a single tree, in two passes:
+     * melds them in pairs, left to right, and then melds those pairs,
+     * right to left.
+     */
+    Node* _combine(Node* first) {
+        Node* pairs = 0;     // in reverse order, linked through _next
+        while (first) {
+            Node* a = first;
+            Node* b = a->_next;
+            first = b ? b->_next : 0;
+            a->_prev = a->_next = 0;
+            if (b) {
+                b->_prev = b->_next = 0;
+                a = _meld(a, b);
+            }
+            a->_next = pairs;
+            pairs = a;
+        }
+        Node* root = 0;
+        while (pairs) {
+            Node* n = pairs;
+            pairs = n->_next;
+            n->_next = 0;
+            root = _meld(root, n);
+        }
+        return root;
+    }
+
+    /** deletes all nodes; avoids recursion, as trees may be very deep */
+    void _clear() {
+        Vector<Node*> pending;
+        if (_root) {
+            pending.push_back(_root);
+        }
+        while (pending.size()) {
+            Node* n = pending.back();
+            pending.pop_back();
+            for (Node* c = n->_child; c; c = c->_next) {
+                pending.push_back(c);
+            }
+            delete n;
+        }
+        _root = 0;
+        _size = 0;
+    }
+};
+
+#endif // EDA_PAIRING_HEAP_H
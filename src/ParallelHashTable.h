@@ -0,0 +1,216 @@
+/**
+ * @file ParallelHashTable.h
+ *
+ * A HashTable that is built and grown by several threads.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_PARALLEL_HASHTABLE_H
+#define EDA_PARALLEL_HASHTABLE_H
+
+#include "Util.h"
+#include "HashTable.h"
+#include "TaskPool.h"
+
+/**
+ * A HashTable that uses the threads of a TaskPool to load many entries
+ * at once (bulk_load()) and to rehash its entries when it grows. Growing
+ * is only parallel for tables with at least PARALLEL_GROW_BINS bins per
+ * thread; smaller ones grow as a HashTable would. Requires C++11.
+ * 
+ * Only its own insert() and insert_batch() grow in parallel: used through
+ * a reference to a HashTable, it grows serially.
+ *
+ * @author mfreire
+ */
+template <class KeyType, class ValueType, bool CACHE_HASHES = false>
+class ParallelHashTable : public HashTable<KeyType, ValueType, CACHE_HASHES> {
+    typedef HashTable<KeyType, ValueType, CACHE_HASHES> Table;
+    typedef typename Table::Stored Stored;
+    typedef typename Table::Bin Bin;
+    typedef typename Table::BinIterator BinIterator;
+    
+    /** bins that each thread must have, at least, to grow in parallel */
+    static const uint PARALLEL_GROW_BINS = 1 << 14;
+    
+    TaskPool* _pool;    ///< where threads come from
+    uint _threads;      ///< threads to use, at most
+    
+public:
+
+    /**
+     * @param pool where threads come from
+     * @param threads number of threads to use; 0 for one per worker
+     */
+    explicit ParallelHashTable(TaskPool& pool, uint threads = 0) 
+            : _pool(&pool), _threads(threads ? threads : pool.threads()) {}
+    
+    /** @return the maximum number of threads used */
+    uint threads() const {
+        return _threads;
+    }
+    
+    /** inserts, growing in parallel if needed */
+    void insert(const KeyType& key, const ValueType& value) {
+        _reserve((ulong)this->_entryCount + 1);
+        Table::insert(key, value);
+    }
+    
+    /** inserts n keys, as HashTable::insert_batch, growing in parallel */
+    void insert_batch(const KeyType* keys, const ValueType* values, uint n) {
+        _reserve((ulong)this->_entryCount + n);
+        Table::insert_batch(keys, values, n);
+    }
+    
+    /**
+     * Inserts all entries in [first, last), as if inserted in order (so
+     * that, for repeated keys, the last value wins), but much faster: the
+     * table grows only once, keys are hashed in parallel, and then sorted
+     * by bin and inserted in parallel, each thread into its own range of
+     * bins.
+     * @param first, last random-access range (such as a pair of pointers)
+     * of elements with _key and _value fields, such as MapEntry
+     */
+    template <class RandomIt>
+    void bulk_load(RandomIt first, RandomIt last) {
+        const uint n = last - first;
+        const uint threads = _threads;
+        this->_counters.inserted(n);
+        _reserve((ulong)this->_entryCount + n);
+        
+        // hash all keys, in chunks of the input
+        uint64_t* hashes = new uint64_t[n];
+        _inParallel(threads, [&](uint c) {
+            for (uint i=(ulong)n*c/threads; i<(ulong)n*(c + 1)/threads; i++) {
+                hashes[i] = hash(first[i]._key);
+            }
+        });
+        
+        // partitions are ranges of bins, each filled by a single thread;
+        // a multiple of 64 bins each, so that bitmap words are not shared
+        uint parts = 1;
+        while (parts < threads && this->_size / (parts * 2) >= 64) {
+            parts *= 2;
+        }
+        const uint binsPerPart = this->_size / parts;
+        
+        // counting sort of input indices, by partition, keeping input order
+        uint* counts = new uint[threads * parts]();
+        _inParallel(threads, [&](uint c) {
+            for (uint i=(ulong)n*c/threads; i<(ulong)n*(c + 1)/threads; i++) {
+                counts[c * parts + this->_binFor(hashes[i]) / binsPerPart] ++;
+            }
+        });
+        uint* partStart = new uint[parts + 1];
+        uint total = 0;
+        for (uint p=0; p<parts; p++) {
+            partStart[p] = total;
+            for (uint c=0; c<threads; c++) {
+                uint count = counts[c * parts + p];
+                counts[c * parts + p] = total;   // now, where c starts in p
+                total += count;
+            }
+        }
+        partStart[parts] = total;
+        uint* order = new uint[n];
+        _inParallel(threads, [&](uint c) {
+            uint* next = counts + c * parts;
+            for (uint i=(ulong)n*c/threads; i<(ulong)n*(c + 1)/threads; i++) {
+                order[next[this->_binFor(hashes[i]) / binsPerPart] ++] = i;
+            }
+        });
+        
+        // fill each partition
+        uint* added = new uint[parts]();
+        _inParallel(parts, [&](uint p) {
+            for (uint j=partStart[p]; j<partStart[p + 1]; j++) {
+                uint i = order[j];
+                uint64_t h = hashes[i];
+                uint b = this->_binFor(h);
+                Bin& bin = this->_bins[b];
+                BinIterator it = bin.begin();
+                while (it != bin.end() && ! it.elem().matches(first[i]._key, h)) {
+                    it.next();
+                }
+                if (it == bin.end()) {
+                    bin.push_back(Stored(first[i]._key, first[i]._value, h));
+                    this->_mark(b);
+                    added[p] ++;
+                } else {
+                    it.set(Stored(first[i]._key, first[i]._value, h));
+                }
+            }
+        });
+        for (uint p=0; p<parts; p++) {
+            this->_entryCount += added[p];
+        }
+        delete[] hashes;
+        delete[] counts;
+        delete[] partStart;
+        delete[] order;
+        delete[] added;
+    }
+    
+private:
+    
+    /** grows until 'entries' entries fit without HashTable growing */
+    void _reserve(ulong entries) {
+        while ((ulong)this->_size * Table::MAX_LOAD_FACTOR <= entries) {
+            if (_threads > 1 && this->_size >= PARALLEL_GROW_BINS * 2) {
+                _grow();
+            } else {
+                this->_resize(this->_size * 2);
+            }
+        }
+    }
+    
+    /** calls f(i) for each i in [0, count), in parallel */
+    template <class Function>
+    void _inParallel(uint count, const Function& f) {
+        _pool->parallel_for(0, count, 1, [&f](ulong from, ulong to) {
+            for (ulong i=from; i<to; i++) {
+                f(i);
+            }
+        });
+    }
+    
+    /**
+     * Doubles the number of bins. The entries of each old bin i can only
+     * go to new bins i or i + (old size), so each thread can move those
+     * of a range of old bins without ever touching those of others.
+     */
+    void _grow() {
+        this->_counters.resizeStarted();
+        const uint oldSize = this->_size;
+        Bin* old = this->_bins;
+        this->_size = oldSize * 2;
+        this->_bins = new Bin[this->_size];
+        delete[] this->_occupied;
+        this->_occupied = new uint64_t[Table::_words(this->_size)]();
+        uint parts = 1;
+        while (parts < _threads && oldSize / (parts * 2) >= PARALLEL_GROW_BINS) {
+            parts *= 2;
+        }
+        const uint binsPerPart = oldSize / parts;
+        _inParallel(parts, [&](uint p) {
+            for (uint i=p * binsPerPart; i<(p + 1) * binsPerPart; i++) {
+                while (old[i].size()) {
+                    uint b = this->_binFor(old[i].back().hash());
+                    old[i].moveBackTo(this->_bins[b]);
+                    this->_mark(b);
+                }
+            }
+        });
+        delete[] old;
+        this->_counters.resizeEnded(true);
+    }
+};
+
+#endif // EDA_PARALLEL_HASHTABLE_H
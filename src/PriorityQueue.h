@@ -0,0 +1,155 @@
+/**
+ * @file PriorityQueue.h
+ *
+ * A priority queue, implemented as a d-ary heap.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_PRIORITY_QUEUE_H
+#define EDA_PRIORITY_QUEUE_H
+
+// default implementation
+#include "Vector.h"
+
+/**
+ * Priority queues allow elements to be added in any order, and extracted
+ * in priority order: top() is always the first element according to
+ * Compare (by default, the smallest one).
+ *
+ * Implemented as an implicit heap with ARITY children per node, stored
+ * in a Vector: push and pop are O(log n), top is O(1), and building
+ * from n elements is O(n). Larger arities make the heap shallower
+ * (cheaper pushes, and fewer cache misses per pop), at the cost of more
+ * comparisons per level when popping; 4 is usually a good compromise.
+ *
+ * @author mfreire
+ */
+template <class Type, class Compare = Less<Type>, uint ARITY = 4>
+class PriorityQueue {
+
+    /** */
+    Vector<Type> _v;
+
+    /** */
+    Compare _before;
+
+public:
+
+    /**  */
+    PriorityQueue(const Compare& before = Compare()) : _before(before) {}
+
+    /**
+     * Builds a queue with all elements between first and last, in O(n)
+     */
+    template <class It>
+    PriorityQueue(It first, It last, const Compare& before = Compare())
+        : _before(before) {
+        copy_back(first, last, _v);
+        _heapify();
+    }
+
+    /**  */
+    void push(const Type& e) {
+        _v.push_back(e);
+        _siftUp(_v.size() - 1);
+    }
+
+    /**
+     * Adds all elements between first and last; if they are many compared
+     * to those already in the queue, rebuilds the heap in O(n) instead of
+     * pushing them one by one
+     */
+    template <class It>
+    void push_n(It first, It last) {
+        uint before = _v.size();
+        copy_back(first, last, _v);
+        uint added = _v.size() - before;
+        if (added > before / 4) {
+            _heapify();
+        } else {
+            for (uint i=before; i<_v.size(); i++) {
+                _siftUp(i);
+            }
+        }
+    }
+
+    /**  */
+    void pop() {
+        Type last = _v.back();
+        _v.pop_back();
+        if (_v.size()) {
+            _siftDown(0, last);
+        }
+    }
+
+    /**  */
+    const Type& top() const {
+        return _v.at(0);
+    }
+
+    /**  */
+    uint size() const {
+        return _v.size();
+    }
+
+private:
+
+    /** moves element at i up until its parent comes before it */
+    void _siftUp(uint i) {
+        Type e = _v.at(i);
+        while (i > 0) {
+            uint parent = (i - 1) / ARITY;
+            if ( ! _before(e, _v.at(parent))) {
+                break;
+            }
+            _v.at(i) = _v.at(parent);
+            i = parent;
+        }
+        _v.at(i) = e;
+    }
+
+    /** places e in the hole at i, or below it, moving children up */
+    void _siftDown(uint i, const Type& e) {
+        uint n = _v.size();
+        for (;;) {
+            uint first = i * ARITY + 1;
+            if (first >= n) {
+                break;
+            }
+            uint last = (first + ARITY < n) ? first + ARITY : n;
+            uint best = first;
+            for (uint c=first+1; c<last; c++) {
+                if (_before(_v.at(c), _v.at(best))) {
+                    best = c;
+                }
+            }
+            if ( ! _before(_v.at(best), e)) {
+                break;
+            }
+            _v.at(i) = _v.at(best);
+            i = best;
+        }
+        _v.at(i) = e;
+    }
+
+    /** Floyd's bottom-up heap construction, O(n) */
+    void _heapify() {
+        uint n = _v.size();
+        if (n < 2) {
+            return;
+        }
+        for (uint i=(n - 2) / ARITY + 1; i>0; i--) {
+            Type e = _v.at(i - 1);
+            _siftDown(i - 1, e);
+        }
+    }
+};
+
+#endif // EDA_PRIORITY_QUEUE_H
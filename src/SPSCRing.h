@@ -0,0 +1,177 @@
+/**
+ * @file SPSCRing.h
+ *
+ * A lock-free single-producer, single-consumer circular buffer.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_SPSC_RING_H
+#define EDA_SPSC_RING_H
+
+#include <atomic>
+
+#include "Util.h"
+
+DECLARE_EXCEPTION(SPSCRingInvalidCapacity)
+
+/**
+ * A fixed-capacity circular buffer that can be shared, without locks,
+ * between exactly one producer thread (which pushes) and exactly one
+ * consumer thread (which pops).
+ *
+ * Works like a CVector, but its start and end indices are atomics that
+ * are only ever written by one side, and they live on separate cache lines
+ * to avoid false sharing. Indices run freely and are reduced with a mask,
+ * so capacity is always a power of two and all slots can be used.
+ * Each side also caches the last-seen index of the other side, so that it
+ * only needs to read the other side's cache line when it appears to be
+ * full (or empty).
+ *
+ * Batch operations (try_push_n, try_pop_n) publish many elements with
+ * a single atomic store.
+ *
+ * @author mfreire
+ */
+template <class Type>
+class SPSCRing {
+
+    Type* _v;    ///< dynamically-reserved array of elements
+    uint _mask;  ///< number of slots in _v, minus one
+
+    char _pad0[EDA_CACHE_LINE];
+    std::atomic<uint> _end;  ///< first free slot; written by producer
+    uint _cachedStart;       ///< producer's last view of _start
+
+    char _pad1[EDA_CACHE_LINE];
+    std::atomic<uint> _start; ///< first used slot; written by consumer
+    uint _cachedEnd;          ///< consumer's last view of _end
+
+    char _pad2[EDA_CACHE_LINE];
+
+public:
+
+    /**
+     * @param capacity minimal capacity; will be rounded up to
+     * the next power of two
+     */
+    SPSCRing(uint capacity) : _cachedStart(0), _cachedEnd(0) {
+        if (capacity == 0 || capacity > (1u << 31)) {
+            throw SPSCRingInvalidCapacity("SPSCRing");
+        }
+        uint max = 1;
+        while (max < capacity) {
+            max *= 2;
+        }
+        _mask = max - 1;
+        _v = new Type[max];
+        _start.store(0, std::memory_order_relaxed);
+        _end.store(0, std::memory_order_relaxed);
+    }
+
+    /**  */
+    ~SPSCRing() {
+        delete[] _v;
+        _v = 0;
+    }
+
+    /**  */
+    uint capacity() const {
+        return _mask + 1;
+    }
+
+    /**
+     * @return number of elements. Only exact if neither side is
+     * concurrently modifying the buffer
+     */
+    uint size() const {
+        return _end.load(std::memory_order_acquire)
+            - _start.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Producer-only.
+     * @return false (and does nothing) if the buffer was full
+     */
+    bool try_push(const Type& e) {
+        uint end = _end.load(std::memory_order_relaxed);
+        if (end - _cachedStart > _mask) {
+            _cachedStart = _start.load(std::memory_order_acquire);
+            if (end - _cachedStart > _mask) {
+                return false;
+            }
+        }
+        _v[end & _mask] = e;
+        _end.store(end + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Producer-only. Pushes as many of the n elements in 'elems' as fit.
+     * @return number of elements pushed, from 0 to n
+     */
+    uint try_push_n(const Type* elems, uint n) {
+        uint end = _end.load(std::memory_order_relaxed);
+        uint free = _mask + 1 - (end - _cachedStart);
+        if (free < n) {
+            _cachedStart = _start.load(std::memory_order_acquire);
+            free = _mask + 1 - (end - _cachedStart);
+            n = (free < n) ? free : n;
+        }
+        for (uint i=0; i<n; i++) {
+            _v[(end + i) & _mask] = elems[i];
+        }
+        _end.store(end + n, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * Consumer-only.
+     * @return false (and does nothing) if the buffer was empty
+     */
+    bool try_pop(Type& e) {
+        uint start = _start.load(std::memory_order_relaxed);
+        if (start == _cachedEnd) {
+            _cachedEnd = _end.load(std::memory_order_acquire);
+            if (start == _cachedEnd) {
+                return false;
+            }
+        }
+        e = _v[start & _mask];
+        _start.store(start + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer-only. Pops up to n elements into 'elems'.
+     * @return number of elements popped, from 0 to n
+     */
+    uint try_pop_n(Type* elems, uint n) {
+        uint start = _start.load(std::memory_order_relaxed);
+        uint used = _cachedEnd - start;
+        if (used < n) {
+            _cachedEnd = _end.load(std::memory_order_acquire);
+            used = _cachedEnd - start;
+            n = (used < n) ? used : n;
+        }
+        for (uint i=0; i<n; i++) {
+            elems[i] = _v[(start + i) & _mask];
+        }
+        _start.store(start + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+
+    // rings are shared by reference; copying one makes no sense
+    SPSCRing(const SPSCRing&);
+    SPSCRing& operator=(const SPSCRing&);
+};
+
+#endif // EDA_SPSC_RING_H
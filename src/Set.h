@@ -60,13 +60,39 @@ public:
     
     /**  */
     bool contains(const KeyType& key) const {
-        return _m.find(key) != _m.end();
+        return _m.contains(key);
+    }
+    
+    /**
+     * Looks up a key of another type; without converting it, if
+     * a TransparentKey of KeyType (see Util.h)
+     */
+    template <class Other>
+    bool contains(const Other& key) const {
+        return _m.contains(key);
+    }
+    
+    /**
+     * Looks up n keys at once; faster than one by one in large sets
+     * @param results set to whether each key is in the set
+     */
+    void contains_batch(const KeyType* keys, uint n, bool* results) const {
+        _m.contains_batch(keys, n, results);
     }
     
     /**  */
     void insert(const KeyType& key) {
         _m.insert(key, EmptyClass());
     }
+    
+    /** inserts n keys, as if one at a time */
+    void insert_batch(const KeyType* keys, uint n) {
+        const uint chunk = 64;
+        EmptyClass none[chunk];
+        for (uint start=0; start<n; start+=chunk) {
+            _m.insert_batch(keys + start, none, (n - start < chunk) ? n - start : chunk);
+        }
+    }
 
     /**  */
     void erase(const KeyType& key) {
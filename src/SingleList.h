@@ -213,8 +213,101 @@ public:
         _size --;
     }
 
+    /**
+     * Sorts the list using operator<, by relinking nodes (no allocation
+     * or copies). Stable bottom-up merge sort: O(n log n).
+     */
+    void sort() {
+        for (uint width = 1; width < _size; width *= 2) {
+            Node *head = 0, *tail = 0;
+            Node *rest = _first;
+            while (rest) {
+                Node *a = rest;
+                Node *b = _cut(a, width);
+                rest = _cut(b, width);
+                _mergeRuns(a, b, head, tail);
+            }
+            _first = head;
+            _last = tail;
+        }
+    }
+    
+    /**
+     * Merges another sorted list into this (sorted) one, emptying
+     * the other list in the process. Stable: on ties, elements from
+     * this list go first. O(n+m), with no allocation.
+     * @param other list to merge (will be emptied)
+     */
+    void merge(SingleList& other) {
+        if (&other == this || other._size == 0) {
+            return;
+        }
+        Node *head = 0, *tail = 0;
+        _mergeRuns(_first, other._first, head, tail);
+        _first = head;
+        _last = tail;
+        _size += other._size;
+        other._first = other._last = 0;
+        other._size = 0;
+    }
+
 private:
     
+    /**
+     * Cuts a chain of nodes after its first 'count' nodes.
+     * @return the first node after the cut, or 0 if none
+     */
+    static Node* _cut(Node *n, uint count) {
+        for (uint i=1; n && i<count; i++) {
+            n = n->_next;
+        }
+        if ( ! n) {
+            return 0;
+        }
+        Node *rest = n->_next;
+        n->_next = 0;
+        return rest;
+    }
+    
+    /** Appends a node to the chain [head, tail] */
+    static void _append(Node *n, Node*& head, Node*& tail) {
+        n->_next = 0;
+        if (tail) {
+            tail->_next = n;
+        } else {
+            head = n;
+        }
+        tail = n;
+    }
+    
+    /** Merges two sorted, 0-terminated chains onto [head, tail] */
+    static void _mergeRuns(Node *a, Node *b, Node*& head, Node*& tail) {
+        while (a && b) {
+            Node *n;
+            if (b->_elem < a->_elem) {
+                n = b;
+                b = b->_next;
+            } else {
+                n = a;
+                a = a->_next;
+            }
+            _append(n, head, tail);
+        }
+        // the remainder is already linked; just hook it up
+        Node *n = a ? a : b;
+        if (n) {
+            if (tail) {
+                tail->_next = n;
+            } else {
+                head = n;
+            }
+            while (n->_next) {
+                n = n->_next;
+            }
+            tail = n;
+        }
+    }
+    
     void _clear() {
         while (_first) {
             Node *n = _first;
@@ -0,0 +1,141 @@
+/**
+ * @file SlidingWindow.h
+ *
+ * Rolling minimum, maximum and sum over a sliding window.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_SLIDING_WINDOW_H
+#define EDA_SLIDING_WINDOW_H
+
+#include "Util.h"
+#include "CVector.h"
+#include "Deque.h"
+
+DECLARE_EXCEPTION(SlidingWindowEmpty)
+
+/**
+ * Keeps the minimum, maximum and sum of the samples in a window that
+ * slides forward as samples are pushed. The window spans the last 'span'
+ * ticks of a clock: with push(v), each sample advances the clock by one
+ * tick, so the window holds the last 'span' samples; with push(v, time),
+ * the caller supplies (non-decreasing) timestamps, and the window holds
+ * the samples of the last 'span' time units. Use one or the other.
+ *
+ * Pushes and evictions are O(1) amortized, and queries are O(1): besides
+ * the samples themselves, two monotonic deques are kept, one with the
+ * samples that may yet become the minimum (increasing from front to back),
+ * and another with those that may yet become the maximum. A new sample
+ * discards, from the back, all those it makes irrelevant.
+ *
+ * Type must support <, + and -, and its default value must be zero.
+ * For floating-point types, the sum may accumulate rounding errors.
+ *
+ * @author mfreire
+ */
+template <class Type>
+class SlidingWindowMinMax {
+
+    /** a sample, and when it was pushed */
+    struct Sample {
+        Type _value;
+        ulong _time;
+
+        Sample() : _value(), _time(0) {}
+        Sample(const Type& value, ulong time) : _value(value), _time(time) {}
+    };
+
+    ulong _span;                          ///< width of the window, in ticks
+    ulong _now;                           ///< time of last push or evict
+    CVector<Sample> _samples;             ///< all samples, oldest first
+    Deque<Sample, CVector<Sample> > _min; ///< candidates for minimum
+    Deque<Sample, CVector<Sample> > _max; ///< candidates for maximum
+    Type _sum;                            ///< sum of all samples
+
+public:
+
+    /**
+     * @param span of the window, in samples (or time units)
+     */
+    SlidingWindowMinMax(ulong span) : _span(span), _now(0), _sum() {}
+
+    /** pushes a sample, one tick after the previous one */
+    void push(const Type& v) {
+        push(v, _now + 1);
+    }
+
+    /** pushes a sample at a given time; times must never decrease */
+    void push(const Type& v, ulong time) {
+        evict(time);
+        if (_span == 0) {
+            return;
+        }
+        Sample s(v, time);
+        _samples.push_back(s);
+        _sum = _sum + v;
+        while (_min.size() && ! (_min.back()._value < v)) {
+            _min.pop_back();
+        }
+        _min.push_back(s);
+        while (_max.size() && ! (v < _max.back()._value)) {
+            _max.pop_back();
+        }
+        _max.push_back(s);
+    }
+
+    /**
+     * Advances the clock to 'time', evicting samples that fall out of
+     * the window. Not needed if samples keep arriving.
+     */
+    void evict(ulong time) {
+        _now = time;
+        while (_samples.size() && _samples.front()._time + _span <= _now) {
+            _sum = _sum - _samples.front()._value;
+            _samples.pop_front();
+        }
+        if (_samples.size() == 0) {
+            _sum = Type();  // drop any accumulated rounding error
+        }
+        while (_min.size() && _min.front()._time + _span <= _now) {
+            _min.pop_front();
+        }
+        while (_max.size() && _max.front()._time + _span <= _now) {
+            _max.pop_front();
+        }
+    }
+
+    /** @return number of samples in the window */
+    uint size() const {
+        return _samples.size();
+    }
+
+    /**  */
+    const Type& min() const {
+        if (_min.size() == 0) {
+            throw SlidingWindowEmpty("min");
+        }
+        return _min.front()._value;
+    }
+
+    /**  */
+    const Type& max() const {
+        if (_max.size() == 0) {
+            throw SlidingWindowEmpty("max");
+        }
+        return _max.front()._value;
+    }
+
+    /** @return sum of samples in the window; zero if none */
+    const Type& sum() const {
+        return _sum;
+    }
+};
+
+#endif // EDA_SLIDING_WINDOW_H
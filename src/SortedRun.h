@@ -0,0 +1,684 @@
+/**
+ * @file SortedRun.h
+ *
+ * Sorted runs: files of sorted entries, looked up and scanned in place.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_SORTED_RUN_H
+#define EDA_SORTED_RUN_H
+
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+#if __cplusplus >= 201103L
+#include <type_traits>
+#endif
+
+#include "Util.h"
+#include "Vector.h"
+#include "MappedFile.h"
+
+DECLARE_EXCEPTION(SortedRunNoSuchElement)
+DECLARE_EXCEPTION(SortedRunIOError)
+DECLARE_EXCEPTION(SortedRunBadFile)
+DECLARE_EXCEPTION(SortedRunUnsorted)
+
+/**
+ * Converts keys and values to and from the bytes stored in a SortedRun.
+ * By default, copies their raw bytes, which only works for trivially
+ * copyable types; specialize it for others (as done for std::string).
+ */
+template <class Type>
+struct SortedRunCodec {
+#if __cplusplus >= 201103L
+    static_assert(std::is_trivially_copyable<Type>::value,
+                  "SortedRunCodec needs a specialization for this type");
+#endif
+
+    static void encode(const Type& v, std::string& out) {
+        out.append((const char*)&v, sizeof(Type));
+    }
+
+    static void decode(const char* data, uint, Type& v) {
+        memcpy(&v, data, sizeof(Type));
+    }
+};
+
+/** strings are stored as their characters */
+template <>
+struct SortedRunCodec<std::string> {
+    static void encode(const std::string& v, std::string& out) {
+        out.append(v);
+    }
+
+    static void decode(const char* data, uint size, std::string& v) {
+        v.assign(data, size);
+    }
+};
+
+/**
+ * Start of a SortedRun file. All offsets are in bytes from the start of
+ * the file, so that it can be mapped at any address.
+ */
+struct SortedRunHeader {
+    /** current file format */
+    static const uint32_t VERSION = 1;
+
+    char magic[8];          ///< "EDARUN" and two 0s
+    uint32_t version;       ///< of the file format
+    uint32_t byteOrder;     ///< 0x01020304, as written by the writer
+    uint64_t entries;       ///< number of entries
+    uint64_t blocks;        ///< number of blocks
+    uint64_t indexOffset;   ///< of the sparse index
+    uint64_t fileSize;      ///< in bytes
+};
+
+/// appends v as a varint: 7 bits per byte, lowest first
+inline void sortedrun_put(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((char)v);
+}
+
+/// reads a varint (of at most 10 bytes), advancing p past it
+inline uint64_t sortedrun_get(const char*& p) {
+    uint64_t v = 0;
+    for (uint shift=0; shift<64; shift+=7) {
+        unsigned char b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (b < 0x80) {
+            break;
+        }
+    }
+    return v;
+}
+
+/// reads a uint32_t, which may not be aligned
+inline uint32_t sortedrun_read32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/**
+ * Writes a SortedRun file, one entry at a time, in increasing order of
+ * keys; only the current block and the sparse index are kept in memory.
+ * Entries are packed into blocks of around blockSize bytes. Each entry
+ * stores, as varints, how many leading bytes its key shares with the
+ * previous key, how many it does not, and how long its value is; and then
+ * the unshared key bytes and the value bytes. Every RESTART_INTERVAL
+ * entries, a 'restart' entry stores its full key; blocks end with the
+ * offsets of their restarts, and then their number (as uint32_t), so that
+ * lookups can binary-search restarts and then decode only a few entries.
+ * Prefix encoding can be turned off, to make scans a little cheaper when
+ * keys share little.
+ *
+ * The file is written under a temporary name, and only renamed to its
+ * final name by finish(); it is removed if the writer is destroyed first.
+ *
+ * @author mfreire
+ */
+template <class KeyType, class ValueType>
+class SortedRunWriter {
+
+    TempFile<SortedRunIOError> _out; ///< closed once finished
+    uint _blockSize;               ///< bytes after which a block is closed
+    bool _prefixEncoding;          ///< false to store full keys
+    uint64_t _entries;             ///< added so far
+    uint _entriesSinceRestart;     ///< in _block, since the last restart
+    uint64_t _offset;              ///< bytes written so far
+    KeyType _last;                 ///< last key added, if any
+    std::string _block;            ///< encoded entries of the current block
+    std::string _previous;         ///< bytes of the previous key in _block
+    Vector<uint32_t> _restarts;    ///< offsets of restarts in _block
+    std::string _key;              ///< bytes of the key being added
+    std::string _value;            ///< bytes of the value being added
+    Vector<uint64_t> _blockStarts; ///< offset of each block in the file
+    Vector<uint64_t> _keyStarts;   ///< offset of each first key in _firstKeys
+    std::string _firstKeys;        ///< bytes of the first key of each block
+
+public:
+
+    /** default bytes per block: 4K, a page */
+    static const uint DEFAULT_BLOCK_SIZE = 4096;
+
+    /** entries from one restart (with a full key) to the next */
+    static const uint RESTART_INTERVAL = 16;
+
+    /**
+     * Starts writing a file
+     * @throws SortedRunIOError if it cannot be created
+     */
+    explicit SortedRunWriter(const std::string& path,
+            bool prefixEncoding = true, uint blockSize = DEFAULT_BLOCK_SIZE)
+            : _out(path), _blockSize(blockSize),
+              _prefixEncoding(prefixEncoding), _entries(0),
+              _entriesSinceRestart(0), _offset(0), _last() {
+        // the header is only known at the end; leave room for it
+        SortedRunHeader h;
+        memset(&h, 0, sizeof(h));
+        _write(&h, sizeof(h));
+    }
+
+    /**
+     * Adds an entry
+     * @throws SortedRunUnsorted if its key is not greater than the last one
+     */
+    void add(const KeyType& key, const ValueType& value) {
+        if ( ! _out.isOpen()) {
+            throw SortedRunIOError("already finished");
+        }
+        if (_entries && ! (_last < key)) {
+            throw SortedRunUnsorted("add");
+        }
+        _key.clear();
+        _value.clear();
+        SortedRunCodec<KeyType>::encode(key, _key);
+        SortedRunCodec<ValueType>::encode(value, _value);
+        uint64_t shared = 0;
+        if (_block.empty()) {
+            _blockStarts.push_back(_offset);
+            _keyStarts.push_back(_firstKeys.size());
+            _firstKeys += _key;
+        }
+        if (_restarts.size() == 0 || _entriesSinceRestart == RESTART_INTERVAL) {
+            _restarts.push_back(_block.size());
+            _entriesSinceRestart = 0;
+        } else if (_prefixEncoding) {
+            uint64_t most = std::min(_key.size(), _previous.size());
+            while (shared < most && _key[shared] == _previous[shared]) {
+                shared ++;
+            }
+        }
+        sortedrun_put(_block, shared);
+        sortedrun_put(_block, _key.size() - shared);
+        sortedrun_put(_block, _value.size());
+        _block.append(_key, shared, std::string::npos);
+        _block += _value;
+        _previous.swap(_key);
+        _last = key;
+        _entries ++;
+        _entriesSinceRestart ++;
+        if (_block.size() >= _blockSize) {
+            _flush();
+        }
+    }
+
+    /** @return entries added so far */
+    ulong size() const {
+        return _entries;
+    }
+
+    /**
+     * Writes the index and the header, and moves the file to its final
+     * name; adding more entries is no longer possible
+     * @throws SortedRunIOError if the file cannot be written
+     */
+    void finish() {
+        if ( ! _out.isOpen()) {
+            throw SortedRunIOError("already finished");
+        }
+        _flush();
+        uint64_t blocks = _blockStarts.size();
+        _blockStarts.push_back(_offset);
+        _keyStarts.push_back(_firstKeys.size());
+        // pad to 8 bytes, so that index offsets can be read in place
+        char zeros[8] = {0};
+        _write(zeros, (8 - _offset % 8) % 8);
+        SortedRunHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "EDARUN\0", 8);
+        h.version = SortedRunHeader::VERSION;
+        h.byteOrder = 0x01020304;
+        h.entries = _entries;
+        h.blocks = blocks;
+        h.indexOffset = _offset;
+        _write(&_blockStarts.at(0), (blocks + 1) * sizeof(uint64_t));
+        _write(&_keyStarts.at(0), (blocks + 1) * sizeof(uint64_t));
+        _write(_firstKeys.data(), _firstKeys.size());
+        h.fileSize = _offset;
+        _out.writeAt(0, &h, sizeof(h));
+        _out.commit();
+    }
+
+private:
+
+    SortedRunWriter(const SortedRunWriter&);
+    SortedRunWriter& operator=(const SortedRunWriter&);
+
+    void _write(const void* data, size_t size) {
+        _out.write(data, size);
+        _offset += size;
+    }
+
+    /** writes out the current block, if any */
+    void _flush() {
+        if (_block.empty()) {
+            return;
+        }
+        for (uint i=0; i<_restarts.size(); i++) {
+            _block.append((const char*)&_restarts.at(i), sizeof(uint32_t));
+        }
+        uint32_t count = _restarts.size();
+        _block.append((const char*)&count, sizeof(uint32_t));
+        _write(_block.data(), _block.size());
+        _block.clear();
+        _previous.clear();
+        while (_restarts.size()) {
+            _restarts.pop_back();
+        }
+    }
+};
+
+/**
+ * A sorted map stored in a file (an "SSTable", after F. Chang et al.,
+ * 2006), which is memory-mapped and searched in place: opening one takes
+ * constant time, and only the pages that lookups and scans touch are ever
+ * read. Entries are in blocks of a few KB, as written by a
+ * SortedRunWriter; a sparse index, with the first key of each block, is
+ * binary-searched to find the only block that may hold a key, then the
+ * restarts of that block, and only then are a few entries decoded. Good
+ * for snapshots of large ordered maps, such as a TreeMap: write() stores
+ * one in sorted order.
+ *
+ * Keys and values are converted to bytes with a SortedRunCodec, which
+ * already handles std::strings and trivially copyable types. Files can
+ * only be read on machines with the same byte order as the one that
+ * wrote them; open() checks the header and the ends of the index, and
+ * lookups and scans throw SortedRunBadFile if they find a corrupt block.
+ * Iterators hold copies of their current key and value, as entries are
+ * decoded from the file. Needs POSIX (for mmap).
+ *
+ * @author mfreire
+ */
+template <class KeyType, class ValueType>
+class SortedRun {
+public:
+
+    /** writes the files that a SortedRun reads */
+    typedef SortedRunWriter<KeyType, ValueType> Writer;
+
+private:
+
+    MappedFile<SortedRunIOError> _file; ///< the whole file
+    uint64_t _entries;              ///< number of entries
+    uint64_t _blocks;               ///< number of blocks
+    const uint64_t* _blockStarts;   ///< blocks + 1 file offsets
+    const uint64_t* _keyStarts;     ///< blocks + 1 offsets into _firstKeys
+    const char* _firstKeys;         ///< first key of each block
+
+public:
+
+    /** an empty run, to open() a file later */
+    SortedRun() : _entries(0), _blocks(0), _blockStarts(0), _keyStarts(0),
+        _firstKeys(0) {}
+
+    /**
+     * Maps a file built with a SortedRunWriter
+     * @throws SortedRunIOError if it cannot be opened or mapped
+     * @throws SortedRunBadFile if it was not written by a SortedRunWriter
+     */
+    explicit SortedRun(const std::string& path)
+            : _entries(0), _blocks(0), _blockStarts(0), _keyStarts(0),
+              _firstKeys(0) {
+        open(path);
+    }
+
+    /** unmaps the file */
+    ~SortedRun() {
+        close();
+    }
+
+    /**
+     * Maps a file built with a SortedRunWriter, replacing any file
+     * already mapped. Takes constant time
+     */
+    void open(const std::string& path) {
+        close();
+        MappedFile<SortedRunIOError> file(path);
+        if (file.size() < sizeof(SortedRunHeader)) {
+            throw SortedRunBadFile(path + ": too short");
+        }
+        const SortedRunHeader& h = *(const SortedRunHeader*)file.data();
+        const char* problem = _check(h, file.size());
+        if (problem) {
+            throw SortedRunBadFile(path + ": " + problem);
+        }
+        _file.swap(file);
+        _entries = h.entries;
+        _blocks = h.blocks;
+        _blockStarts = (const uint64_t*)(_file.data() + h.indexOffset);
+        _keyStarts = _blockStarts + _blocks + 1;
+        _firstKeys = (const char*)(_keyStarts + _blocks + 1);
+    }
+
+    /** unmaps the file, if any, and leaves the run empty */
+    void close() {
+        _file.close();
+        _firstKeys = 0;
+        _entries = _blocks = 0;
+        _blockStarts = _keyStarts = 0;
+    }
+
+    /**
+     * Writes the entries of a map (such as a TreeMap, or a Map::T) to a
+     * file, in increasing order of keys. If the map does not iterate in
+     * that order (a TreeMap iterates in decreasing order, and a HashTable
+     * in none at all), its entries are sorted first, using 16 bytes of
+     * memory per entry.
+     * @throws SortedRunIOError if the file cannot be written
+     */
+    template <class Map>
+    static void write(const Map& map, const std::string& path,
+            bool prefixEncoding = true,
+            uint blockSize = Writer::DEFAULT_BLOCK_SIZE) {
+        uint n = map.size();
+        Item* items = new Item[n];
+        bool sorted = true;
+        uint i = 0;
+        typename Map::Iterator it = map.begin();
+        for (; it != map.end(); it.next(), i++) {
+            items[i]._key = &it.key();
+            items[i]._value = &it.value();
+            sorted = sorted && (i == 0 || *items[i - 1]._key < *items[i]._key);
+        }
+        try {
+            if ( ! sorted) {
+                std::sort(items, items + n);
+            }
+            Writer out(path, prefixEncoding, blockSize);
+            for (i=0; i<n; i++) {
+                out.add(*items[i]._key, *items[i]._value);
+            }
+            out.finish();
+        } catch (...) {
+            delete[] items;
+            throw;
+        }
+        delete[] items;
+    }
+
+    /** */
+    uint size() const {
+        return (uint)_entries;
+    }
+
+    /** @return bytes of the mapped file, whether paged in or not */
+    ulong bytes() const {
+        return _file.size();
+    }
+
+    /** @return number of blocks */
+    ulong blocks() const {
+        return _blocks;
+    }
+
+    class Iterator {
+    public:
+        void next() {
+            if ( ! _current) {
+                throw SortedRunNoSuchElement("next");
+            }
+            if (_current == _blockEnd) {
+                _enter(_block + 1);
+            } else {
+                _decode();
+            }
+        }
+
+        const KeyType& key() const {
+            return _key;
+        }
+
+        const ValueType& value() const {
+            return _value;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return _current == other._current;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return _current != other._current;
+        }
+    protected:
+        friend class SortedRun;
+
+        const SortedRun* _run;
+        uint64_t _block;         ///< block of the current entry
+        const char* _current;    ///< just past the current entry, or 0 at end
+        const char* _blockEnd;   ///< end of the entries of _block
+        std::string _bytes;      ///< of the current key
+        KeyType _key;            ///< current key
+        ValueType _value;        ///< current value
+
+        /**
+         * An iterator at a restart of block b (or at the end)
+         * @param offset of the restart, from the start of the block
+         */
+        Iterator(const SortedRun* run, uint64_t b, uint32_t offset = 0)
+                : _run(run), _current(0), _blockEnd(0), _key(), _value() {
+            _enter(b, offset);
+        }
+
+        void _enter(uint64_t b, uint32_t offset = 0) {
+            _block = b;
+            if (b >= _run->_blocks) {
+                _current = _blockEnd = 0;
+                return;
+            }
+            _blockEnd = _run->_restartsOf(b);
+            _current = _run->_file.data() + _run->_blockStarts[b] + offset;
+            _decode();
+        }
+
+        /** decodes the entry at _current, and moves _current past it */
+        void _decode() {
+            uint64_t shared = sortedrun_get(_current);
+            uint64_t unshared = sortedrun_get(_current);
+            uint64_t valueSize = sortedrun_get(_current);
+            if (shared > _bytes.size() || _current > _blockEnd
+                    || unshared > (ulong)(_blockEnd - _current)
+                    || valueSize > (ulong)(_blockEnd - _current) - unshared) {
+                throw SortedRunBadFile("corrupt entry");
+            }
+            _bytes.resize(shared);
+            _bytes.append(_current, unshared);
+            _current += unshared;
+            SortedRunCodec<KeyType>::decode(_bytes.data(), _bytes.size(), _key);
+            SortedRunCodec<ValueType>::decode(_current, valueSize, _value);
+            _current += valueSize;
+        }
+    };
+
+    /** iterates entries in increasing order of keys */
+    Iterator begin() const {
+        return Iterator(this, 0);
+    }
+
+    /** */
+    Iterator end() const {
+        return Iterator(this, _blocks);
+    }
+
+    /** @return an iterator at the first entry whose key is not less than key */
+    Iterator lower_bound(const KeyType& key) const {
+        // the last block whose first key is not greater than key
+        uint64_t lo = 0, hi = _blocks;
+        KeyType first = KeyType();
+        while (hi - lo > 1) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            _firstKey(mid, first);
+            if (key < first) {
+                hi = mid;
+            } else {
+                lo = mid;
+            }
+        }
+        if (_blocks == 0) {
+            return end();
+        }
+        // and, within it, the last restart whose key is not greater either
+        const char* restarts = _restartsOf(lo);
+        const char* start = _file.data() + _blockStarts[lo];
+        const char* blockEnd = _file.data() + _blockStarts[lo + 1];
+        uint32_t rlo = 0, rhi = sortedrun_read32(blockEnd - 4);
+        while (rhi - rlo > 1) {
+            uint32_t mid = rlo + (rhi - rlo) / 2;
+            const char* p = start + _restart(restarts, mid, restarts - start);
+            sortedrun_get(p);   // shared: always 0 at restarts
+            uint64_t size = sortedrun_get(p);
+            sortedrun_get(p);   // value size
+            if (p > restarts || size > (ulong)(restarts - p)) {
+                throw SortedRunBadFile("corrupt entry");
+            }
+            SortedRunCodec<KeyType>::decode(p, size, first);
+            if (key < first) {
+                rhi = mid;
+            } else {
+                rlo = mid;
+            }
+        }
+        Iterator it(this, lo, _restart(restarts, rlo, restarts - start));
+        while (it._current && it._key < key) {
+            it.next();
+        }
+        return it;
+    }
+
+    /** */
+    Iterator find(const KeyType& key) const {
+        Iterator it = lower_bound(key);
+        return (it._current && ! (key < it._key)) ? it : end();
+    }
+
+    /** @return the value of a key, decoded from the file */
+    ValueType at(const KeyType& key) const {
+        Iterator it = find(key);
+        if ( ! it._current) {
+            throw SortedRunNoSuchElement("at");
+        }
+        return it._value;
+    }
+
+    /** */
+    bool contains(const KeyType& key) const {
+        return find(key)._current != 0;
+    }
+
+    /**
+     * Calls visit(key, value) for each entry with from <= key < to, in
+     * order
+     * @return number of entries visited
+     */
+    template <class Visitor>
+    uint scan(const KeyType& from, const KeyType& to, Visitor visit) const {
+        uint count = 0;
+        Iterator it = lower_bound(from);
+        for (; it._current && it._key < to; it.next()) {
+            visit(it._key, it._value);
+            count ++;
+        }
+        return count;
+    }
+
+private:
+
+    SortedRun(const SortedRun&);
+    SortedRun& operator=(const SortedRun&);
+
+    /**
+     * @return start of the restart offsets of block b; also where its
+     * entries end
+     */
+    const char* _restartsOf(uint64_t b) const {
+        // open() only checks the first and last offsets: checking all would
+        // read the whole index
+        uint64_t from = _blockStarts[b], to = _blockStarts[b + 1];
+        if (from > to || to > _blockStarts[_blocks] || to - from < 4) {
+            throw SortedRunBadFile("corrupt block");
+        }
+        const char* end = _file.data() + to;
+        uint32_t count = sortedrun_read32(end - 4);
+        if (count == 0 || count > (to - from - 4) / 4) {
+            throw SortedRunBadFile("corrupt block");
+        }
+        return end - 4 - 4 * (ulong)count;
+    }
+
+    /**
+     * @return offset i in the restarts of a block of 'size' bytes of
+     * entries
+     */
+    static uint32_t _restart(const char* restarts, uint32_t i, ulong size) {
+        uint32_t offset = sortedrun_read32(restarts + 4 * i);
+        if (offset >= size) {
+            throw SortedRunBadFile("corrupt block");
+        }
+        return offset;
+    }
+
+    /** decodes the first key of block b */
+    void _firstKey(uint64_t b, KeyType& key) const {
+        uint64_t from = _keyStarts[b], to = _keyStarts[b + 1];
+        if (from > to || to > _keyStarts[_blocks]) {
+            throw SortedRunBadFile("corrupt index");
+        }
+        SortedRunCodec<KeyType>::decode(_firstKeys + from, to - from, key);
+    }
+
+    /** a map entry, as sorted by write() */
+    struct Item {
+        const KeyType* _key;
+        const ValueType* _value;
+
+        bool operator<(const Item& other) const {
+            return *_key < *other._key;
+        }
+    };
+
+    /** @return what is wrong with a header, or 0 if nothing */
+    static const char* _check(const SortedRunHeader& h, ulong fileSize) {
+        if (memcmp(h.magic, "EDARUN\0", 8) != 0) {
+            return "not a SortedRun";
+        }
+        if (h.version != SortedRunHeader::VERSION) {
+            return "unsupported version";
+        }
+        if (h.byteOrder != 0x01020304) {
+            return "written with another byte order";
+        }
+        if (h.fileSize != fileSize || h.indexOffset % 8 != 0
+                || h.indexOffset < sizeof(SortedRunHeader)
+                || h.indexOffset > fileSize
+                || h.blocks >= (fileSize - h.indexOffset) / 16
+                || (h.blocks == 0) != (h.entries == 0)) {
+            return "corrupt header";
+        }
+        // the header is the start of the mapping; the index follows it
+        const uint64_t* blockStarts =
+            (const uint64_t*)((const char*)&h + h.indexOffset);
+        const uint64_t* keyStarts = blockStarts + h.blocks + 1;
+        uint64_t firstKeysOffset = h.indexOffset + (h.blocks + 1) * 16;
+        if (blockStarts[0] != sizeof(SortedRunHeader)
+                || blockStarts[h.blocks] > h.indexOffset
+                || keyStarts[0] != 0
+                || keyStarts[h.blocks] != fileSize - firstKeysOffset) {
+            return "corrupt index";
+        }
+        return 0;
+    }
+};
+
+#endif // EDA_SORTED_RUN_H
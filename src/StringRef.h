@@ -0,0 +1,133 @@
+/**
+ * @file StringRef.h
+ *
+ * A reference to a sequence of characters owned by someone else.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_STRING_REF_H
+#define EDA_STRING_REF_H
+
+#include <string>
+#include <cstring>
+#include <iostream>
+
+#include "Util.h"
+#include "Hash.h"
+
+/**
+ * A pointer and a length, describing characters that live elsewhere
+ * (for example, a key within a network buffer); they need not end in
+ * '\0', and must outlive the StringRef. Compares and hashes exactly like
+ * a std::string with the same characters, so it can be used to look up
+ * string keys in a HashTable, TreeMap, Map or Set without allocating:
+ * <pre>
+ * Map<std::string, int>::H m;
+ * ...
+ * if (m.contains(StringRef(buffer + start, length))) ...
+ * </pre>
+ * A (pre-C++17) stand-in for std::string_view.
+ *
+ * @author mfreire
+ */
+class StringRef {
+    const char* _data;  ///< first character
+    std::size_t _size;  ///< number of characters
+
+public:
+
+    /**  */
+    StringRef(const char* data, std::size_t size) : _data(data), _size(size) {}
+
+    /** refers to a '\0'-terminated string */
+    StringRef(const char* s) : _data(s), _size(strlen(s)) {}
+
+    /** refers to the characters of s, which must not change meanwhile */
+    StringRef(const std::string& s) : _data(s.data()), _size(s.size()) {}
+
+    /**  */
+    const char* data() const {
+        return _data;
+    }
+
+    /**  */
+    std::size_t size() const {
+        return _size;
+    }
+
+    /** @return a copy of the characters, as a std::string */
+    std::string str() const {
+        return std::string(_data, _size);
+    }
+
+    /** @return <0, 0 or >0 if this comes before, is equal to, or comes after s */
+    int compare(const StringRef& s) const {
+        int c = memcmp(_data, s._data, _size < s._size ? _size : s._size);
+        if (c != 0) {
+            return c;
+        }
+        return _size < s._size ? -1 : (_size > s._size ? 1 : 0);
+    }
+};
+
+inline bool operator==(const StringRef& a, const StringRef& b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size()) == 0;
+}
+
+inline bool operator!=(const StringRef& a, const StringRef& b) {
+    return ! (a == b);
+}
+
+inline bool operator<(const StringRef& a, const StringRef& b) {
+    return a.compare(b) < 0;
+}
+
+// mixed comparisons with std::string, which would otherwise be ambiguous
+
+inline bool operator==(const std::string& a, const StringRef& b) {
+    return StringRef(a) == b;
+}
+
+inline bool operator==(const StringRef& a, const std::string& b) {
+    return a == StringRef(b);
+}
+
+inline bool operator!=(const std::string& a, const StringRef& b) {
+    return StringRef(a) != b;
+}
+
+inline bool operator!=(const StringRef& a, const std::string& b) {
+    return a != StringRef(b);
+}
+
+inline bool operator<(const std::string& a, const StringRef& b) {
+    return StringRef(a) < b;
+}
+
+inline bool operator<(const StringRef& a, const std::string& b) {
+    return a < StringRef(b);
+}
+
+/// std::ostream output
+inline std::ostream& operator<<(std::ostream& out, const StringRef& s) {
+    return out.write(s.data(), s.size());
+}
+
+/// same hash as that of the equivalent std::string
+inline uint64_t hash(const StringRef& key) {
+    return hash_bytes(key.data(), key.size());
+}
+
+template<>
+struct TransparentKey<std::string, StringRef> {
+    static const bool value = true;
+};
+
+#endif // EDA_STRING_REF_H
@@ -0,0 +1,295 @@
+/**
+ * @file TaskPool.h
+ *
+ * A fork/join thread pool with work stealing.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_TASK_POOL_H
+#define EDA_TASK_POOL_H
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+
+#include "Util.h"
+#include "Queue.h"
+#include "WorkStealingDeque.h"
+
+/**
+ * A pool of worker threads that run tasks, for fork/join parallelism:
+ * spawn() tasks into a Group, and later sync() on that group to wait until
+ * all of them (and any tasks they spawn in turn) have finished.
+ * parallel_for() builds on these to split a range of indices into chunks.
+ *
+ * Each worker keeps its own WorkStealingDeque of tasks: it runs its most
+ * recently spawned task first, and, when it runs out, steals the oldest
+ * task of a random victim. Tasks spawned from threads outside the pool
+ * go through a shared Queue. Threads that sync() do not just wait: they run
+ * pending tasks until their group is done, so recursive spawn/sync never
+ * deadlocks and no thread sits idle while there is work to do.
+ * Idle workers yield for a while, and then sleep until new tasks arrive.
+ *
+ * @author mfreire
+ */
+class TaskPool {
+public:
+
+    /**
+     * A set of tasks that can be waited for. Must outlive its tasks.
+     */
+    class Group {
+    public:
+        Group() : _pending(0) {}
+
+        /** @return number of spawned tasks that have not yet finished */
+        uint pending() const {
+            return _pending.load(std::memory_order_acquire);
+        }
+    private:
+        friend class TaskPool;
+
+        std::atomic<uint> _pending;
+
+        Group(const Group&);
+        Group& operator=(const Group&);
+    };
+
+private:
+
+    /** a spawned function, and the group to report to when done */
+    struct Task {
+        std::function<void()> _f;
+        Group* _group;
+
+        Task(const std::function<void()>& f, Group* g) : _f(f), _group(g) {}
+    };
+
+    /** per-worker state */
+    struct Worker {
+        WorkStealingDeque<Task*> _tasks;
+        std::thread* _thread;
+        uint _seed;   ///< to choose steal victims
+    };
+
+    /** which worker of which pool the calling thread is, if any */
+    struct Identity {
+        TaskPool* _pool;
+        uint _index;
+    };
+
+    /// failed rounds of task-hunting before an idle worker sleeps
+    static const uint IDLE_ROUNDS = 64;
+
+    Worker* _workers;          ///< one per thread
+    uint _count;               ///< number of workers
+    std::atomic<bool> _stop;   ///< set when shutting down
+
+    std::mutex _m;                 ///< guards _external and sleeping
+    Queue<Task*> _external;        ///< tasks from outside threads
+    std::atomic<uint> _externalCount; ///< to peek at _external without locking
+    std::condition_variable _wake; ///< to wake up sleeping workers
+    std::atomic<uint> _sleeping;   ///< number of sleeping workers
+
+public:
+
+    /**
+     * @param threads number of workers; 0 to use one per hardware thread
+     */
+    TaskPool(uint threads = 0)
+        : _stop(false), _externalCount(0), _sleeping(0) {
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+            threads = threads ? threads : 1;
+        }
+        _count = threads;
+        _workers = new Worker[_count];
+        for (uint i=0; i<_count; i++) {
+            _workers[i]._seed = 2463534242u + i;
+        }
+        for (uint i=0; i<_count; i++) {
+            _workers[i]._thread = new std::thread(&TaskPool::_work, this, i);
+        }
+    }
+
+    /** waits for pending tasks to be run, and then stops all workers */
+    ~TaskPool() {
+        _stop.store(true);
+        {
+            std::lock_guard<std::mutex> lock(_m);
+            _wake.notify_all();
+        }
+        for (uint i=0; i<_count; i++) {
+            _workers[i]._thread->join();
+            delete _workers[i]._thread;
+        }
+        delete[] _workers;
+        _workers = 0;
+    }
+
+    /**
+     * A pool shared by the whole process, with one worker
+     * per hardware thread; created on first use
+     */
+    static TaskPool& global() {
+        static TaskPool pool;
+        return pool;
+    }
+
+    /**  */
+    uint threads() const {
+        return _count;
+    }
+
+    /**
+     * Schedules f to be run by some thread, as part of group g.
+     */
+    void spawn(Group& g, const std::function<void()>& f) {
+        Task* t = new Task(f, &g);
+        g._pending.fetch_add(1, std::memory_order_relaxed);
+        Identity& self = _identity();
+        if (self._pool == this) {
+            _workers[self._index]._tasks.push(t);
+        } else {
+            std::lock_guard<std::mutex> lock(_m);
+            _external.push(t);
+            _externalCount.fetch_add(1, std::memory_order_release);
+        }
+        if (_sleeping.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(_m);
+            _wake.notify_one();
+        }
+    }
+
+    /**
+     * Returns once all tasks in g have finished, running pending tasks
+     * (from this or other groups) in the meantime.
+     */
+    void sync(Group& g) {
+        Identity& self = _identity();
+        int index = (self._pool == this) ? (int)self._index : -1;
+        uint seed = 88172645u;
+        while (g._pending.load(std::memory_order_acquire)) {
+            Task* t = _find(index, seed);
+            if (t) {
+                _run(t);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * Calls f(from, to) on consecutive chunks of [begin, end) of at most
+     * 'grain' indices each, in parallel, and returns once all are done.
+     * The range is split in halves recursively, so that thieves get
+     * large chunks.
+     */
+    template <class Function>
+    void parallel_for(ulong begin, ulong end, ulong grain, const Function& f) {
+        Group g;
+        _split(g, begin, end, grain ? grain : 1, f);
+        sync(g);
+    }
+
+private:
+
+    // pools are shared by reference; copying one makes no sense
+    TaskPool(const TaskPool&);
+    TaskPool& operator=(const TaskPool&);
+
+    static Identity& _identity() {
+        static thread_local Identity self = {0, 0};
+        return self;
+    }
+
+    template <class Function>
+    void _split(Group& g, ulong begin, ulong end, ulong grain,
+                const Function& f) {
+        while (end - begin > grain) {
+            ulong mid = begin + (end - begin) / 2;
+            spawn(g, [this, &g, mid, end, grain, &f]() {
+                _split(g, mid, end, grain, f);
+            });
+            end = mid;
+        }
+        f(begin, end);
+    }
+
+    void _run(Task* t) {
+        t->_f();
+        t->_group->_pending.fetch_sub(1, std::memory_order_release);
+        delete t;
+    }
+
+    /**
+     * Looks for a task: own deque first, then external submissions,
+     * then stealing from others.
+     * @param index of worker looking for tasks, or -1 if not a worker
+     * @return a task, or 0 if none found
+     */
+    Task* _find(int index, uint& seed) {
+        Task* t = 0;
+        if (index >= 0 && _workers[index]._tasks.pop(t)) {
+            return t;
+        }
+        if (_externalCount.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(_m);
+            if (_external.size()) {
+                t = _external.front();
+                _external.pop();
+                _externalCount.fetch_sub(1, std::memory_order_relaxed);
+                return t;
+            }
+        }
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        for (uint i=0; i<_count; i++) {
+            uint victim = (seed + i) % _count;
+            if ((int)victim != index && _workers[victim]._tasks.steal(t)) {
+                return t;
+            }
+        }
+        return 0;
+    }
+
+    void _work(uint index) {
+        Identity& self = _identity();
+        self._pool = this;
+        self._index = index;
+        uint idle = 0;
+        for (;;) {
+            Task* t = _find(index, _workers[index]._seed);
+            if (t) {
+                _run(t);
+                idle = 0;
+            } else if (_stop.load(std::memory_order_acquire)) {
+                break;
+            } else if (++ idle < IDLE_ROUNDS) {
+                std::this_thread::yield();
+            } else {
+                // sleep, but not for long: a spawn may have missed us
+                std::unique_lock<std::mutex> lock(_m);
+                _sleeping.fetch_add(1);
+                if ( ! _externalCount.load() && ! _stop.load()) {
+                    _wake.wait_for(lock, std::chrono::milliseconds(1));
+                }
+                _sleeping.fetch_sub(1);
+                idle = 0;
+            }
+        }
+    }
+};
+
+#endif // EDA_TASK_POOL_H
@@ -0,0 +1,214 @@
+/**
+ * @file TimerWheel.h
+ *
+ * A hierarchical timing wheel, for large numbers of timers.
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_TIMER_WHEEL_H
+#define EDA_TIMER_WHEEL_H
+
+#include "Util.h"
+#include "IntrusiveList.h"
+
+/**
+ * Timer fields for a TimerWheel. Embed one in each class whose objects
+ * you want to schedule; use one hook per wheel that an object can
+ * simultaneously be in.
+ */
+struct TimerHook {
+    ListHook _link;   ///< links timers in the same bucket
+    ulong _expiry;    ///< tick at which the timer expires
+    uint _bucket;     ///< bucket that the timer is in, if scheduled
+
+    TimerHook() : _expiry(0), _bucket(0) {}
+
+    /** copying an object must not copy its schedule */
+    TimerHook(const TimerHook&) : _expiry(0), _bucket(0) {}
+
+    /** assigning to an object must not change its schedule */
+    TimerHook& operator=(const TimerHook&) {
+        return *this;
+    }
+
+    /** @return true if currently scheduled */
+    bool scheduled() const {
+        return _link.linked();
+    }
+
+    /** @return tick at which the timer expires (or expired) */
+    ulong expiry() const {
+        return _expiry;
+    }
+};
+
+/**
+ * Keeps track of timers, each of which expires at a given tick of
+ * a clock, and reports those that expire as the clock advances.
+ * Like an IntrusiveList, it never allocates: timers are linked through
+ * a TimerHook member. For example, given
+ * <pre>
+ * struct Connection { int fd; TimerHook _timeout; };
+ * </pre>
+ * use a <code>TimerWheel<Connection, &Connection::_timeout></code>.
+ *
+ * Implemented as a hierarchy of LEVELS wheels of 256 buckets each
+ * (G. Varghese and T. Lauck, 1987): level 0 has one bucket per tick,
+ * level 1 one per 256 ticks, and so on. schedule() and cancel() are O(1),
+ * since they only link or unlink a timer. As the clock reaches each
+ * bucket of an upper level, its timers are moved down to finer buckets;
+ * each timer moves at most LEVELS - 1 times, so advancing is O(1)
+ * amortized per tick and per timer. Timers too far into the future for
+ * the top level are kept in its farthest bucket, and re-placed when
+ * reached. LEVELS can be at most 7, for a range of 2^56 ticks.
+ *
+ * @author mfreire
+ */
+template <class Type, TimerHook Type::*Hook, uint LEVELS = 4>
+class TimerWheel {
+
+    /// bits of the clock handled by each level
+    static const uint BITS = 8;
+    /// buckets per level
+    static const uint SLOTS = 1 << BITS;
+    /// to extract a bucket index from a tick
+    static const uint MASK = SLOTS - 1;
+
+    typedef IntrusiveList<TimerHook, &TimerHook::_link> Bucket;
+
+    Bucket _buckets[LEVELS * SLOTS];  ///< level l starts at l * SLOTS
+    ulong _now;                       ///< last tick processed
+    uint _size;                       ///< number of scheduled timers
+
+public:
+
+    /**
+     * @param now initial tick of the clock
+     */
+    TimerWheel(ulong now = 0) : _now(now), _size(0) {}
+
+    /** unschedules all timers */
+    ~TimerWheel() {
+        for (uint i=0; i<LEVELS * SLOTS; i++) {
+            _buckets[i].clear();
+        }
+    }
+
+    /** @return number of scheduled timers */
+    uint size() const {
+        return _size;
+    }
+
+    /** @return last tick processed by advance() */
+    ulong now() const {
+        return _now;
+    }
+
+    /**
+     * Schedules t to expire at tick 'expiry' (or at the next tick, if
+     * that one has already passed); if t was already scheduled in this
+     * wheel, it is rescheduled. O(1)
+     */
+    void schedule(Type& t, ulong expiry) {
+        TimerHook& h = t.*Hook;
+        if (h.scheduled()) {
+            _buckets[h._bucket].erase(h);
+            _size --;
+        }
+        h._expiry = expiry;
+        _place(h, _now + 1);
+        _size ++;
+    }
+
+    /**
+     * Unschedules t, which must have been scheduled in this wheel (if
+     * at all). O(1)
+     * @return false (and does nothing) if t was not scheduled
+     */
+    bool cancel(Type& t) {
+        TimerHook& h = t.*Hook;
+        if ( ! h.scheduled()) {
+            return false;
+        }
+        _buckets[h._bucket].erase(h);
+        _size --;
+        return true;
+    }
+
+    /**
+     * Advances the clock to tick 'time', calling expired(Type&) on each
+     * timer that expires in the meantime, in order of expiry. Each timer is
+     * unscheduled before being passed to 'expired', which may freely
+     * schedule or cancel any timers (including this one).
+     * @return number of expired timers
+     */
+    template <class Callback>
+    uint advance(ulong time, const Callback& expired) {
+        uint count = 0;
+        while (_now < time) {
+            if (_size == 0) {
+                _now = time;
+                break;
+            }
+            _now ++;
+            uint index = _now & MASK;
+            for (uint l=1; l<LEVELS && index == 0; l++) {
+                index = (_now >> (l * BITS)) & MASK;
+                _cascade(l * SLOTS + index);
+            }
+            Bucket& due = _buckets[_now & MASK];
+            while (due.size()) {
+                TimerHook& h = due.front();
+                due.pop_front();
+                _size --;
+                count ++;
+                expired(*ownerOf(&h, Hook));
+            }
+        }
+        return count;
+    }
+
+private:
+
+    // timers point into the wheel; copying one makes no sense
+    TimerWheel(const TimerWheel&);
+    TimerWheel& operator=(const TimerWheel&);
+
+    /**
+     * Links h into the bucket for its expiry, relative to _now
+     * @param earliest tick to use if h has already expired
+     */
+    void _place(TimerHook& h, ulong earliest) {
+        ulong expiry = (h._expiry > earliest) ? h._expiry : earliest;
+        ulong delta = expiry - _now;
+        uint l = 0;
+        while (l < LEVELS - 1 && delta >= (1ul << ((l + 1) * BITS))) {
+            l ++;
+        }
+        if (delta >= (1ul << (LEVELS * BITS))) {
+            // beyond the top level: park in its farthest bucket
+            expiry = _now + (1ul << (LEVELS * BITS)) - 1;
+        }
+        h._bucket = l * SLOTS + ((expiry >> (l * BITS)) & MASK);
+        _buckets[h._bucket].push_back(h);
+    }
+
+    /** moves all timers in a bucket to finer-grained buckets */
+    void _cascade(uint bucket) {
+        Bucket& b = _buckets[bucket];
+        while (b.size()) {
+            TimerHook& h = b.front();
+            b.pop_front();
+            _place(h, _now);
+        }
+    }
+};
+
+#endif // EDA_TIMER_WHEEL_H
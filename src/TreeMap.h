@@ -29,6 +29,10 @@ DECLARE_EXCEPTION(TreeMapInvalidAccess)
  * and removals. However, this implementation does not make the effort
  * of keeping it balanced, so it can be much worse.
  * 
+ * Keys can also be looked up (find, at, contains) through other types,
+ * without converting them into KeyType, if marked as a TransparentKey
+ * (for example, <code>const char*</code> for <code>std::string</code> keys).
+ * 
  * @author mfreire
  */
 template <class KeyType, class ValueType>
@@ -36,6 +40,9 @@ class TreeMap {
     typedef MapEntry<KeyType, ValueType> Entry;
     typedef typename BinTree<Entry>::Node Node;
     
+    /** keys looked up together by batch operations */
+    static const uint BATCH = 16;
+    
     BinTree<Entry> _t; ///< sorted binary tree for key-value entries
     uint _entryCount;  ///< number of key-value entries in tree
     
@@ -103,7 +110,8 @@ public:
         }        
               
         /** */
-        Iterator(Node* start, const KeyType& key) {
+        template <class Key>
+        Iterator(Node* start, const Key& key) {
             Node *n = start;
             bool found = false;
             while (n && ! found) {
@@ -119,7 +127,8 @@ public:
                     }
                 }
             }
-            _current = _firstInOrder(n);
+            // ascendants above n are already stacked; n itself comes next
+            _current = n;
         }        
         
         Node *_firstInOrder(Node *n) {
@@ -143,6 +152,20 @@ public:
         return Iterator(_t._root, key);
     }
     
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, Iterator>::type
+    find(const Other& key) const {
+        return Iterator(_t._root, key);
+    }
+
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, Iterator>::type
+    find(const Other& key) {
+        return Iterator(_t._root, key);
+    }
+    
     /** */
     Iterator begin() const {
         return Iterator(_t._root);
@@ -155,24 +178,86 @@ public:
     
     /** */
     const ValueType& at(const KeyType& key) const {        
-        Node *p = _t._root;
-        bool leftChild;
-        Node *n = _nodeFor(key, p, leftChild);
-        if ( ! n) {
-            throw TreeMapNoSuchElement("at");
-        }
-        return n->_elem._value;
+        return _at(key);
     }
     
     /** */
     ValueType& at(const KeyType& key) {
+        return _at(key);
+    }
+    
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, const ValueType&>::type
+    at(const Other& key) const {
+        return _at(key);
+    }
+    
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, ValueType&>::type
+    at(const Other& key) {
+        return _at(key);
+    }
+    
+    /** unlike find, never allocates */
+    bool contains(const KeyType& key) const {
         Node *p = _t._root;
         bool leftChild;
-        Node *n = _nodeFor(key, p, leftChild);
-        if ( ! n) {
-            throw TreeMapNoSuchElement("at");
+        return _nodeFor(key, p, leftChild) != 0;
+    }
+    
+    /** looks up a TransparentKey of KeyType, without converting it */
+    template <class Other>
+    typename EnableIf<TransparentKey<KeyType, Other>::value, bool>::type
+    contains(const Other& key) const {
+        Node *p = _t._root;
+        bool leftChild;
+        return _nodeFor(key, p, leftChild) != 0;
+    }
+    
+    /**
+     * Looks up n keys, faster than one at a time in trees much larger
+     * than the cache: descends for a group of keys at once, one level at
+     * a time, prefetching the next node of each, so that their cache
+     * misses overlap instead of coming one after another.
+     * @param values set to a pointer to the value of each key, or to 0 if
+     * not found; pointers are valid until the entry is erased
+     */
+    void find_batch(const KeyType* keys, uint n, ValueType** values) {
+        Node* found[BATCH];
+        for (uint start=0; start<n; start+=BATCH) {
+            uint m = (n - start < BATCH) ? n - start : BATCH;
+            _findGroup(keys + start, m, found);
+            for (uint i=0; i<m; i++) {
+                values[start + i] = found[i] ? &found[i]->_elem._value : 0;
+            }
+        }
+    }
+    
+    /**
+     * Like find_batch
+     * @param results set to whether each key is in the tree
+     */
+    void contains_batch(const KeyType* keys, uint n, bool* results) const {
+        Node* found[BATCH];
+        for (uint start=0; start<n; start+=BATCH) {
+            uint m = (n - start < BATCH) ? n - start : BATCH;
+            _findGroup(keys + start, m, found);
+            for (uint i=0; i<m; i++) {
+                results[start + i] = found[i] != 0;
+            }
+        }
+    }
+    
+    /**
+     * Inserts n keys with their values. Simply one at a time, since each
+     * insertion can change the path to the next ones.
+     */
+    void insert_batch(const KeyType* keys, const ValueType* values, uint n) {
+        for (uint i=0; i<n; i++) {
+            insert(keys[i], values[i]);
         }
-        return n->_elem._value;        
     }
     
     /** */
@@ -200,7 +285,7 @@ public:
     /** */
     void erase(const KeyType& key) {
         Node *p = _t._root;
-        bool leftChild; 
+        bool leftChild = false;
         Node *n = _nodeFor(key, p, leftChild);
         if ( ! n) {
             throw TreeMapNoSuchElement("erase");
@@ -240,6 +325,49 @@ public:
     
 private:
 
+    /** finds m keys (at most BATCH); found[i] is 0 if keys[i] is missing */
+    void _findGroup(const KeyType* keys, uint m, Node** found) const {
+        Node* current[BATCH];
+        for (uint i=0; i<m; i++) {
+            current[i] = _t._root;
+            found[i] = 0;
+        }
+        uint active = m;
+        while (active) {
+            active = 0;
+            for (uint i=0; i<m; i++) {
+                Node* n = current[i];
+                if ( ! n) {
+                    continue;
+                }
+                const KeyType& nodeKey = n->_elem._key;
+                if (nodeKey == keys[i]) {
+                    found[i] = n;
+                    n = 0;
+                } else {
+                    // as in _nodeFor, larger keys are to the left
+                    n = (nodeKey < keys[i]) ? n->_left : n->_right;
+                }
+                if (n) {
+                    EDA_PREFETCH(n);
+                    active ++;
+                }
+                current[i] = n;
+            }
+        }
+    }
+
+    template <class Key>
+    ValueType& _at(const Key& key) const {
+        Node *p = _t._root;
+        bool leftChild;
+        Node *n = _nodeFor(key, p, leftChild);
+        if ( ! n) {
+            throw TreeMapNoSuchElement("at");
+        }
+        return n->_elem._value;
+    }
+
     /**
      * Calculates average path-length stats for the tree
      */
@@ -306,7 +434,8 @@ private:
      * the left of parent; false if to the right or undecided
      * @return node with the key, 0 if not found
      */
-    static Node *_nodeFor(const KeyType& key, Node*& parent, bool &left) {
+    template <class Key>
+    static Node *_nodeFor(const Key& key, Node*& parent, bool &left) {
         Node *n = parent;
         while (n) {
             const KeyType& nodeKey = n->_elem._key;
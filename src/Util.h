@@ -18,6 +18,10 @@
 #include <string>
 #include <iostream>
 #include <iosfwd>
+#include <cstddef>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 typedef unsigned int uint;
 typedef unsigned long ulong;
@@ -42,6 +46,18 @@ inline std::ostream &operator<<(std::ostream &out, const AbstractException &e) {
     return out << e._msg;
 }
 
+/// Bytes in a cache line. Concurrent structures use this to keep fields
+///     that are written by different threads apart (avoiding false sharing)
+#define EDA_CACHE_LINE 64
+
+/// Hints that the memory at an address will soon be read, so that it
+///     can be fetched into the cache meanwhile; does nothing if unsupported
+#if defined(__GNUC__)
+#define EDA_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define EDA_PREFETCH(address)
+#endif
+
 /// Macro to create subclasses of the base exception.
 ///     use as: DECLARE_EXCEPTION(UniqueExceptionName)
 #define DECLARE_EXCEPTION(ExceptionSubclass) \
@@ -51,6 +67,77 @@ public: \
     ExceptionSubclass(const std::string &msg) : AbstractException(msg) {} \
 };
 
+/**
+ * Given a pointer to a field within an object, returns the object itself.
+ *     Used by intrusive containers to get from the link fields that are
+ *     embedded in user objects back to those objects.
+ */
+template<class Owner, class Field>
+Owner* ownerOf(Field* field, Field Owner::*member) {
+    Owner* probe = reinterpret_cast<Owner*>(field);
+    ptrdiff_t offset = reinterpret_cast<char*>(&(probe->*member))
+        - reinterpret_cast<char*>(probe);
+    return reinterpret_cast<Owner*>(reinterpret_cast<char*>(field) - offset);
+}
+
+/**
+ * Default comparison for ordered containers: a comes before b if a < b.
+ *     Supply another class with the same operator() to change the order
+ */
+template<class Type>
+struct Less {
+    bool operator()(const Type& a, const Type& b) const {
+        return a < b;
+    }
+};
+
+/**
+ * Defines 'type' (as Type) only if Condition is true. Used to restrict
+ *     templates to some types: others are silently discarded (SFINAE)
+ */
+template<bool Condition, class Type = void>
+struct EnableIf {};
+
+template<class Type>
+struct EnableIf<true, Type> {
+    typedef Type type;
+};
+
+/**
+ * Allows looking up keys of type Other in associative containers whose
+ *     keys are of type KeyType, without first converting them into KeyType
+ *     (for example, looking up a <code>const char*</code> among
+ *     <code>std::string</code> keys, without allocating a string).
+ *     Specialize with value = true only for types whose hash(), == and <
+ *     match those of the KeyType that they would convert into
+ */
+template<class KeyType, class Other>
+struct TransparentKey {
+    static const bool value = false;
+};
+
+template<>
+struct TransparentKey<std::string, const char*> {
+    static const bool value = true;
+};
+
+template<>
+struct TransparentKey<std::string, char*> {
+    static const bool value = true;
+};
+
+template<std::size_t N>
+struct TransparentKey<std::string, char[N]> {
+    static const bool value = true;
+};
+
+#if __cplusplus >= 201703L
+template<>
+struct TransparentKey<std::string, std::string_view> {
+    static const bool value = true;
+};
+#endif
+
 /**
  * Copies all elements between first and last at the back of a given container
  */
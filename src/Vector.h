@@ -202,8 +202,8 @@ public:
         if (_used == 0) {
             throw VectorInvalidIndex("pop_front");
         }
-        for (int i=0; i<=_used; i++) {
-            _v[i] = _v[i+1];
+        for (uint i=1; i<_used; i++) {
+            _v[i-1] = _v[i];
         }
         _used --;
     }    
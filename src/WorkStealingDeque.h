@@ -0,0 +1,175 @@
+/**
+ * @file WorkStealingDeque.h
+ *
+ * A lock-free work-stealing deque (Chase-Lev deque).
+ *
+ * Estructura de Datos y Algoritmos
+ *
+ * Copyright (C) 2014
+ * Facultad de Informática, Universidad Complutense de Madrid
+ * This software is licensed under the Simplified BSD licence:
+ *    (see the LICENSE file or
+ *    visit opensource.org/licenses/BSD-3-Clause)
+ */
+
+#ifndef EDA_WORK_STEALING_DEQUE_H
+#define EDA_WORK_STEALING_DEQUE_H
+
+#include <atomic>
+
+#include "Util.h"
+#include "Vector.h"
+
+/**
+ * A double-ended queue with one owner thread, which pushes and pops at
+ * the back (last in, first out), and any number of thief threads, which
+ * steal from the front (first in, first out). Used by task schedulers:
+ * each worker keeps its own tasks in a deque, works on the most recent
+ * ones (which are hot in its cache), and idle workers steal the oldest
+ * ones (which, in divide-and-conquer algorithms, are the largest).
+ *
+ * Implements the deque of D. Chase and Y. Lev (2005), with the memory
+ * orderings of N. M. Lê et al. (2013). The owner only synchronizes with
+ * thieves when they compete for the last element. The circular buffer
+ * grows as needed; since thieves may still be reading an old buffer,
+ * those are only freed when the deque is destroyed (they add up to less
+ * than the current one).
+ *
+ * Type must be trivially copyable, and is typically a pointer to a task.
+ *
+ * @author mfreire
+ */
+template <class Type>
+class WorkStealingDeque {
+
+    /// initial size to reserve for an empty deque
+    static const long INITIAL_SIZE = 64;
+
+    /** a circular buffer */
+    struct Buffer {
+        long _mask;               ///< number of slots, minus one
+        std::atomic<Type>* _v;    ///< slots
+
+        Buffer(long size) : _mask(size - 1), _v(new std::atomic<Type>[size]) {}
+        ~Buffer() {
+            delete[] _v;
+        }
+
+        Type get(long i) const {
+            return _v[i & _mask].load(std::memory_order_relaxed);
+        }
+        void put(long i, const Type& e) {
+            _v[i & _mask].store(e, std::memory_order_relaxed);
+        }
+    };
+
+    std::atomic<long> _front;   ///< next to steal; written by thieves
+    char _pad0[EDA_CACHE_LINE];
+    std::atomic<long> _back;    ///< next free slot; written by owner
+    std::atomic<Buffer*> _buffer; ///< current buffer
+    Vector<Buffer*> _old;       ///< outgrown buffers; freed on destruction
+    char _pad1[EDA_CACHE_LINE];
+
+public:
+
+    /**  */
+    WorkStealingDeque() : _front(0), _back(0) {
+        _buffer.store(new Buffer(INITIAL_SIZE), std::memory_order_relaxed);
+    }
+
+    /** no thread may be using the deque */
+    ~WorkStealingDeque() {
+        delete _buffer.load();
+        while (_old.size()) {
+            delete _old.back();
+            _old.pop_back();
+        }
+    }
+
+    /**
+     * @return number of elements. Only exact if no other thread is
+     * concurrently modifying the deque
+     */
+    uint size() const {
+        long b = _back.load(std::memory_order_relaxed);
+        long f = _front.load(std::memory_order_relaxed);
+        return (b > f) ? (uint)(b - f) : 0;
+    }
+
+    /** Owner-only. Pushes at the back */
+    void push(const Type& e) {
+        long b = _back.load(std::memory_order_relaxed);
+        long f = _front.load(std::memory_order_acquire);
+        Buffer* a = _buffer.load(std::memory_order_relaxed);
+        if (b - f > a->_mask) {
+            a = _grow(a, f, b);
+        }
+        a->put(b, e);
+        _back.store(b + 1, std::memory_order_release);
+    }
+
+    /**
+     * Owner-only. Pops from the back.
+     * @return false (and does nothing) if the deque was empty
+     */
+    bool pop(Type& e) {
+        long b = _back.load(std::memory_order_relaxed) - 1;
+        Buffer* a = _buffer.load(std::memory_order_relaxed);
+        _back.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long f = _front.load(std::memory_order_relaxed);
+        bool found = false;
+        if (f <= b) {
+            e = a->get(b);
+            found = true;
+            if (f == b) {
+                // last element: race thieves for it
+                found = _front.compare_exchange_strong(f, f + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed);
+                _back.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            _back.store(b + 1, std::memory_order_relaxed);
+        }
+        return found;
+    }
+
+    /**
+     * Any thread. Steals from the front.
+     * @return false (and does nothing) if the deque was empty, or another
+     * thread won the race for the front element
+     */
+    bool steal(Type& e) {
+        long f = _front.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long b = _back.load(std::memory_order_acquire);
+        if (f < b) {
+            Buffer* a = _buffer.load(std::memory_order_acquire);
+            Type stolen = a->get(f);
+            if (_front.compare_exchange_strong(f, f + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                e = stolen;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+
+    // deques are shared by reference; copying one makes no sense
+    WorkStealingDeque(const WorkStealingDeque&);
+    WorkStealingDeque& operator=(const WorkStealingDeque&);
+
+    Buffer* _grow(Buffer* a, long f, long b) {
+        Buffer* bigger = new Buffer((a->_mask + 1) * 2);
+        for (long i=f; i<b; i++) {
+            bigger->put(i, a->get(i));
+        }
+        _old.push_back(a);
+        _buffer.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+};
+
+#endif // EDA_WORK_STEALING_DEQUE_H
@@ -0,0 +1,1574 @@
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <new>
+#include <fstream>
+
+#include "SPSCRing.h"
+#include "MPMCQueue.h"
+#include "BlockingQueue.h"
+#include "ConcurrentStack.h"
+#include "Stack.h"
+#include "TaskPool.h"
+#include "ParallelHashTable.h"
+#include "BlockDeque.h"
+#include "DeVector.h"
+#include "SlidingWindow.h"
+#include "PriorityQueue.h"
+#include "PairingHeap.h"
+#include "TimerWheel.h"
+#include "LRUCache.h"
+#include "Hash.h"
+#include "StringRef.h"
+#include "FrozenMap.h"
+#include "MappedHashTable.h"
+#include "SortedRun.h"
+#include "BloomFilter.h"
+#include "Map.h"
+#include "Set.h"
+#include "TreeMap.h"
+#include "Vector.h"
+#include "Queue.h"
+#include "CVector.h"
+
+using namespace std;
+
+/** wall-clock seconds since an arbitrary start; clock() counts all threads */
+double now() {
+    return chrono::duration<double>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** calls to operator new while countAllocations is set */
+ulong allocations = 0;
+/** only set while a single thread is running */
+bool countAllocations = false;
+
+void* operator new(size_t size) {
+    if (countAllocations) {
+        allocations ++;
+    }
+    void* p = malloc(size ? size : 1);
+    if ( ! p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+/** out of line, or gcc warns about free()ing what operator new returned */
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void benchSPSCRing() {
+    cout << "===========\nBENCH_SPSC_RING\n===========\n";
+    const uint n = 200000000;
+    const uint batches[] = {1, 16, 256};
+    for (uint b=0; b<sizeof(batches)/sizeof(batches[0]); b++) {
+        const uint batch = batches[b];
+        SPSCRing<uint> ring(1 << 16);
+        ulong sum = 0;
+        double start = now();
+        thread consumer([&]() {
+            uint buffer[256];
+            uint received = 0;
+            while (received < n) {
+                uint got = (batch == 1) ?
+                    ring.try_pop(buffer[0]) : ring.try_pop_n(buffer, batch);
+                if ( ! got) {
+                    this_thread::yield();
+                }
+                for (uint i=0; i<got; i++) {
+                    sum += buffer[i];
+                }
+                received += got;
+            }
+        });
+        uint buffer[256];
+        for (uint sent = 0; sent < n; ) {
+            for (uint i=0; i<batch; i++) {
+                buffer[i] = sent + i;
+            }
+            uint count = (n - sent < batch) ? n - sent : batch;
+            uint pushed = 0;
+            while (pushed < count) {
+                uint more = (batch == 1) ? ring.try_push(buffer[0])
+                    : ring.try_push_n(buffer + pushed, count - pushed);
+                if ( ! more) {
+                    this_thread::yield();
+                }
+                pushed += more;
+            }
+            sent += count;
+        }
+        consumer.join();
+        double elapsed = now() - start;
+        if (sum != (ulong)n * (n - 1) / 2) {
+            cout << "ERROR: checksum mismatch" << endl;
+        }
+        cout << n << " items in batches of " << batch << ": "
+             << elapsed << " s, " << (n / elapsed / 1e6) << " M items/s" << endl;
+    }
+}
+
+/**
+ * Times p producers and c consumers passing n items through a queue
+ * @return millions of items per second
+ */
+template <class Q>
+double runProducersConsumers(Q& q, uint p, uint c, uint n) {
+    thread** threads = new thread*[p + c];
+    double start = now();
+    for (uint i=0; i<p; i++) {
+        uint count = n / p + (i < n % p ? 1 : 0);
+        threads[i] = new thread([&q, count]() {
+            for (uint j=0; j<count; j++) {
+                q.push(j);
+            }
+        });
+    }
+    for (uint i=0; i<c; i++) {
+        uint count = n / c + (i < n % c ? 1 : 0);
+        threads[p + i] = new thread([&q, count]() {
+            uint e;
+            for (uint j=0; j<count; j++) {
+                q.pop(e);
+            }
+        });
+    }
+    for (uint i=0; i<p + c; i++) {
+        threads[i]->join();
+        delete threads[i];
+    }
+    delete[] threads;
+    return n / (now() - start) / 1e6;
+}
+
+/** a Queue guarded by a mutex, with the same interface as MPMCQueue */
+class MutexQueue {
+    Queue<uint, CVector<uint> > _q;
+    mutex _m;
+public:
+    void push(uint e) {
+        for (;;) {
+            {
+                lock_guard<mutex> lock(_m);
+                if (_q.size() < (1 << 16)) {
+                    _q.push(e);
+                    return;
+                }
+            }
+            this_thread::yield();
+        }
+    }
+    void pop(uint& e) {
+        for (;;) {
+            {
+                lock_guard<mutex> lock(_m);
+                if (_q.size()) {
+                    e = _q.front();
+                    _q.pop();
+                    return;
+                }
+            }
+            this_thread::yield();
+        }
+    }
+};
+
+void benchMPMCQueue() {
+    cout << "===========\nBENCH_MPMC_QUEUE\n===========\n";
+    const uint n = 4000000;
+    const uint counts[] = {1, 2, 4, 8, 16, 32};
+    const uint k = sizeof(counts)/sizeof(counts[0]);
+    cout << "M items/s for MPMCQueue / mutex-guarded Queue" << endl;
+    cout << "prod\\cons";
+    for (uint j=0; j<k; j++) {
+        cout << "\t" << counts[j];
+    }
+    cout << endl;
+    for (uint i=0; i<k; i++) {
+        cout << counts[i];
+        for (uint j=0; j<k; j++) {
+            MPMCQueue<uint> q(1 << 16);
+            MutexQueue m;
+            double lockFree = runProducersConsumers(q, counts[i], counts[j], n);
+            double locked = runProducersConsumers(m, counts[i], counts[j], n);
+            cout << "\t" << (int)lockFree << "/" << (int)locked;
+        }
+        cout << endl;
+    }
+}
+
+void benchBlockingQueue() {
+    cout << "===========\nBENCH_BLOCKING_QUEUE\n===========\n";
+    const uint n = 2000000;
+    const uint batches[] = {1, 16, 256};
+    const uint capacities[] = {64, 4096};
+    for (uint c=0; c<sizeof(capacities)/sizeof(capacities[0]); c++) {
+        for (uint b=0; b<sizeof(batches)/sizeof(batches[0]); b++) {
+            BlockingQueue<double> q(capacities[c]);
+            Vector<double> latencies;
+            double start = now();
+            thread producer([&]() {
+                for (uint i=0; i<n; i++) {
+                    q.push(now());
+                }
+                q.close();
+            });
+            Vector<double> batch;
+            double e;
+            if (batches[b] == 1) {
+                while (q.pop(e)) {
+                    latencies.push_back(now() - e);
+                }
+            } else {
+                while (q.pop_up_to(batch, batches[b])) {
+                    double t = now();
+                    while (batch.size()) {
+                        latencies.push_back(t - batch.back());
+                        batch.pop_back();
+                    }
+                }
+            }
+            producer.join();
+            double elapsed = now() - start;
+            latencies.sort();
+            cout << "capacity " << capacities[c] << ", pop batches of " 
+                 << batches[b] << ": " << (n / elapsed / 1e6) << " M items/s; "
+                 << "latency (us) p50 " 
+                 << latencies.at(n / 2) * 1e6 << ", p99 "
+                 << latencies.at(n / 100 * 99) * 1e6 << endl;
+        }
+    }
+}
+
+/** a Stack guarded by a mutex, with the same interface as ConcurrentStack */
+class MutexStack {
+    Stack<uint> _s;
+    mutex _m;
+public:
+    void push(uint e) {
+        lock_guard<mutex> lock(_m);
+        _s.push(e);
+    }
+    bool pop(uint& e) {
+        lock_guard<mutex> lock(_m);
+        if ( ! _s.size()) {
+            return false;
+        }
+        e = _s.top();
+        _s.pop();
+        return true;
+    }
+};
+
+/**
+ * Times t threads, each pushing and then popping back n/t items
+ * (as when using the stack as a free-list)
+ * @return millions of push+pop pairs per second
+ */
+template <class S>
+double runPushPop(S& s, uint t, uint n) {
+    thread** threads = new thread*[t];
+    double start = now();
+    for (uint i=0; i<t; i++) {
+        threads[i] = new thread([&s, t, n]() {
+            uint e;
+            for (uint j=0; j<n/t; j++) {
+                s.push(j);
+                s.pop(e);
+            }
+        });
+    }
+    for (uint i=0; i<t; i++) {
+        threads[i]->join();
+        delete threads[i];
+    }
+    delete[] threads;
+    return n / (now() - start) / 1e6;
+}
+
+void benchConcurrentStack() {
+    cout << "===========\nBENCH_CONCURRENT_STACK\n===========\n";
+    const uint n = 4000000;
+    for (uint t=1; t<=16; t*=2) {
+        ConcurrentStack<uint> s;
+        MutexStack m;
+        double lockFree = runPushPop(s, t, n);
+        double locked = runPushPop(m, t, n);
+        cout << t << " threads: " << lockFree << " M push+pop/s lock-free, " 
+             << locked << " with mutex-guarded Stack" << endl;
+    }
+}
+
+long fib(int n) {
+    return n < 2 ? n : fib(n-1) + fib(n-2);
+}
+
+long parallelFib(TaskPool& pool, int n) {
+    if (n < 20) {
+        return fib(n);
+    }
+    long a, b;
+    TaskPool::Group g;
+    pool.spawn(g, [&]() { a = parallelFib(pool, n-1); });
+    b = parallelFib(pool, n-2);
+    pool.sync(g);
+    return a + b;
+}
+
+void benchTaskPool() {
+    cout << "===========\nBENCH_TASK_POOL\n===========\n";
+    const int f = 40;
+    const ulong n = 200000000;
+    uint* v = new uint[n];
+    for (ulong i=0; i<n; i++) {
+        v[i] = (uint)i;
+    }
+    
+    double start = now();
+    long serialFib = fib(f);
+    double fibSerial = now() - start;
+    start = now();
+    ulong serialSum = 0;
+    for (ulong i=0; i<n; i++) {
+        serialSum += v[i];
+    }
+    double sumSerial = now() - start;
+    cout << "serial: fib(" << f << ") " << fibSerial << " s, sum of " << n 
+         << " " << sumSerial << " s" << endl;
+    
+    uint hardware = thread::hardware_concurrency();
+    for (uint t=1; t<=(hardware > 8 ? hardware : 8); t*=2) {
+        TaskPool pool(t);
+        start = now();
+        long parallel = parallelFib(pool, f);
+        double fibElapsed = now() - start;
+        
+        atomic<ulong> sum(0);
+        start = now();
+        pool.parallel_for(0, n, 1 << 16, [&](ulong from, ulong to) {
+            ulong partial = 0;
+            for (ulong i=from; i<to; i++) {
+                partial += v[i];
+            }
+            sum += partial;
+        });
+        double sumElapsed = now() - start;
+        if (parallel != serialFib || sum != serialSum) {
+            cout << "ERROR: results do not match" << endl;
+        }
+        cout << t << " workers: fib " << fibElapsed << " s (speedup " 
+             << fibSerial / fibElapsed << "), sum " << sumElapsed 
+             << " s (speedup " << sumSerial / sumElapsed << ")" << endl;
+    }
+    delete[] v;
+}
+
+/**
+ * Times n push_backs followed by n pop_fronts
+ * @return seconds for pushes, and the slowest single push
+ */
+template <class C>
+void runPushes(C& c, uint n, double& total, double& worst) {
+    worst = 0;
+    double start = now(), last = start;
+    for (uint i=0; i<n; i++) {
+        c.push_back(i);
+        if ((i & (i - 1)) == 0 || (i & 0xfff) == 0) {
+            // growth happens at powers of two; sample around them
+            double t = now();
+            worst = (t - last > worst) ? t - last : worst;
+            last = t;
+        }
+    }
+    total = now() - start;
+}
+
+void benchBlockDeque() {
+    cout << "===========\nBENCH_BLOCK_DEQUE\n===========\n";
+    const uint n = 100000000;
+    double total, worst;
+    {
+        CVector<uint> c;
+        runPushes(c, n, total, worst);
+        cout << n << " push_backs in CVector: " << total 
+             << " s, worst stall " << worst * 1e3 << " ms" << endl;
+    }
+    {
+        BlockDeque<uint> b;
+        runPushes(b, n, total, worst);
+        cout << n << " push_backs in BlockDeque: " << total 
+             << " s, worst stall " << worst * 1e3 << " ms" << endl;
+        double start = now();
+        ulong sum = 0;
+        for (uint i=0; i<n; i++) {
+            sum += b.at(i);
+        }
+        cout << n << " random-access reads in BlockDeque: " << now() - start
+             << " s (checksum " << sum << ")" << endl;
+    }
+}
+
+/**
+ * Front-heavy work: n push_fronts, then n pop_fronts interleaved
+ * with push_backs (a queue that is fed and drained at opposite ends).
+ */
+template <class Container>
+double runFrontHeavy(Container& c, uint n) {
+    double start = now();
+    for (uint i=0; i<n; i++) {
+        c.push_front(i);
+    }
+    for (uint i=0; i<n; i++) {
+        c.push_back(c.front());
+        c.pop_front();
+    }
+    return now() - start;
+}
+
+void benchDeVector() {
+    cout << "===========\nBENCH_DEVECTOR\n===========\n";
+    const uint n = 20000000;
+    {
+        CVector<uint> c;
+        cout << "front-heavy, " << n << " elements, CVector: " 
+             << runFrontHeavy(c, n) << " s" << endl;
+    }
+    {
+        DeVector<uint> d;
+        cout << "front-heavy, " << n << " elements, DeVector: " 
+             << runFrontHeavy(d, n) << " s" << endl;
+        double start = now();
+        ulong sum = 0;
+        const uint *p = d.data();
+        for (uint i=0; i<n; i++) {
+            sum += p[i];
+        }
+        cout << n << " contiguous reads in DeVector: " << now() - start
+             << " s (checksum " << sum << ")" << endl;
+    }
+    {
+        // Vector::push_front is O(n); keep this one small
+        const uint m = 20000;
+        Vector<uint> v;
+        cout << "front-heavy, " << m << " elements, Vector: " 
+             << runFrontHeavy(v, m) << " s" << endl;
+    }
+}
+
+void benchCVectorWindow() {
+    cout << "===========\nBENCH_CVECTOR_WINDOW\n===========\n";
+    const uint series = 100000, window = 64, samples = 256;
+    double start = now();
+    {
+        CVector<uint>* s = new CVector<uint>[series];
+        for (uint j=0; j<samples; j++) {
+            for (uint i=0; i<series; i++) {
+                if (s[i].size() == window) {
+                    s[i].pop_front();
+                }
+                s[i].push_back(i + j);
+            }
+        }
+        ulong sum = 0;
+        for (uint i=0; i<series; i++) {
+            for (uint k=0; k<s[i].size(); k++) {
+                sum += s[i].at(k);
+            }
+        }
+        cout << series << " series, last " << window << " of " << samples
+             << " samples, growable CVector: " << now() - start
+             << " s, " << (ulong)series * s[0].capacity() * sizeof(uint) / (1<<20)
+             << " MB (checksum " << sum << ")" << endl;
+        delete[] s;
+    }
+    start = now();
+    {
+        CVector<uint>** s = new CVector<uint>*[series];
+        for (uint i=0; i<series; i++) {
+            s[i] = new CVector<uint>(window, FIXED_CAPACITY);
+        }
+        for (uint j=0; j<samples; j++) {
+            for (uint i=0; i<series; i++) {
+                s[i]->push_back(i + j);
+            }
+        }
+        ulong sum = 0;
+        for (uint i=0; i<series; i++) {
+            const uint *a, *b;
+            uint na, nb;
+            s[i]->segments(a, na, b, nb);
+            for (uint k=0; k<na; k++) sum += a[k];
+            for (uint k=0; k<nb; k++) sum += b[k];
+        }
+        cout << series << " series, last " << window << " of " << samples
+             << " samples, fixed CVector: " << now() - start
+             << " s, " << (ulong)series * (window + 1) * sizeof(uint) / (1<<20)
+             << " MB (checksum " << sum << ")" << endl;
+        for (uint i=0; i<series; i++) {
+            delete s[i];
+        }
+        delete[] s;
+    }
+}
+
+void benchSlidingWindow() {
+    cout << "===========\nBENCH_SLIDING_WINDOW\n===========\n";
+    for (uint window=1000; window<=1000000; window*=10) {
+        // naive: rescan a fixed-size CVector after every sample
+        const uint rescans = 200000000 / window;
+        CVector<long> last(window, FIXED_CAPACITY);
+        uint seed = 2463534242u;
+        for (uint i=0; i<window; i++) {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            last.push_back(seed % 100000);
+        }
+        double start = now();
+        long check = 0;
+        for (uint i=0; i<rescans; i++) {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            last.push_back(seed % 100000);
+            const long *a, *b;
+            uint na, nb;
+            last.segments(a, na, b, nb);
+            long lo = a[0], hi = a[0], sum = 0;
+            for (uint k=0; k<na; k++) {
+                lo = a[k] < lo ? a[k] : lo;
+                hi = a[k] > hi ? a[k] : hi;
+                sum += a[k];
+            }
+            for (uint k=0; k<nb; k++) {
+                lo = b[k] < lo ? b[k] : lo;
+                hi = b[k] > hi ? b[k] : hi;
+                sum += b[k];
+            }
+            check += lo + hi + sum;
+        }
+        double naive = (now() - start) / rescans;
+
+        // monotonic deques
+        const uint pushes = 10000000;
+        SlidingWindowMinMax<long> w(window);
+        start = now();
+        for (uint i=0; i<pushes; i++) {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            w.push(seed % 100000);
+            check += w.min() + w.max() + w.sum();
+        }
+        double mono = (now() - start) / pushes;
+        cout << "window " << window << ": rescan " << naive * 1e9 
+             << " ns/sample, monotonic " << mono * 1e9 
+             << " ns/sample (checksum " << check << ")" << endl;
+    }
+}
+
+/**
+ * 'Hold' model of a scheduler: n pending deadlines, then ops rounds of
+ * taking the earliest one and scheduling a later one
+ */
+template <class PQ>
+double runHold(PQ& q, uint n, uint ops) {
+    uint seed = 2463534242u;
+    double start = now();
+    for (uint i=0; i<n; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        q.push(seed % (n * 16));
+    }
+    for (uint i=0; i<ops; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        ulong t = q.top();
+        q.pop();
+        q.push(t + seed % (n * 16));
+    }
+    return now() - start;
+}
+
+/** a TreeMap used as a priority queue, as schedulers used to do */
+class TreeMapQueue {
+    // TreeMap iterates from largest to smallest key: store complements,
+    // and make keys unique with a sequence number in the low bits
+    TreeMap<ulong, ulong> _t;
+    ulong _seq;
+public:
+    TreeMapQueue() : _seq(0) {}
+    void push(ulong e) {
+        _t.insert(~((e << 24) | (_seq++ & 0xffffff)), e);
+    }
+    ulong top() const {
+        return _t.begin().value();
+    }
+    void pop() {
+        _t.erase(_t.begin().key());
+    }
+};
+
+void benchPriorityQueue() {
+    cout << "===========\nBENCH_PRIORITY_QUEUE\n===========\n";
+    const uint ops = 5000000;
+    for (uint n=1000; n<=1000000; n*=100) {
+        {
+            PriorityQueue<ulong, Less<ulong>, 2> q;
+            cout << n << " pending, " << ops << " pop+push, arity 2: " 
+                 << runHold(q, n, ops) << " s" << endl;
+        }
+        {
+            PriorityQueue<ulong, Less<ulong>, 4> q;
+            cout << n << " pending, " << ops << " pop+push, arity 4: " 
+                 << runHold(q, n, ops) << " s" << endl;
+        }
+        {
+            PriorityQueue<ulong, Less<ulong>, 8> q;
+            cout << n << " pending, " << ops << " pop+push, arity 8: " 
+                 << runHold(q, n, ops) << " s" << endl;
+        }
+        {
+            TreeMapQueue q;
+            cout << n << " pending, " << ops << " pop+push, TreeMap: " 
+                 << runHold(q, n, ops) << " s" << endl;
+        }
+    }
+    const uint n = 10000000;
+    Vector<ulong> v;
+    uint seed = 88172645u;
+    for (uint i=0; i<n; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        v.push_back(seed);
+    }
+    double start = now();
+    PriorityQueue<ulong> built(v.begin(), v.end());
+    double heapify = now() - start;
+    start = now();
+    PriorityQueue<ulong> pushed;
+    for (uint i=0; i<n; i++) {
+        pushed.push(v.at(i));
+    }
+    cout << n << " elements: heapify " << heapify << " s, one by one "
+         << now() - start << " s (tops " << built.top() << ", " 
+         << pushed.top() << ")" << endl;
+}
+
+/** a tentative distance to a node, ordered by distance */
+struct Distance {
+    ulong _d;
+    uint _node;
+    Distance() : _d(0), _node(0) {}
+    Distance(ulong d, uint node) : _d(d), _node(node) {}
+    bool operator<(const Distance& other) const {
+        return _d < other._d;
+    }
+};
+
+/** a directed graph in compressed sparse row form */
+struct Graph {
+    uint _n;
+    uint* _first;   ///< edges of u are [_first[u], _first[u+1])
+    uint* _to;
+    uint* _weight;
+
+    Graph(uint n, uint degree) : _n(n) {
+        _first = new uint[n + 1];
+        _to = new uint[(ulong)n * degree];
+        _weight = new uint[(ulong)n * degree];
+        uint seed = 2463534242u, e = 0;
+        for (uint u=0; u<n; u++) {
+            _first[u] = e;
+            for (uint i=0; i<degree; i++, e++) {
+                seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+                // first edge forms a cycle, so that all nodes are reachable
+                _to[e] = i ? seed % n : (u + 1) % n;
+                _weight[e] = 1 + seed % 1000;
+            }
+        }
+        _first[n] = e;
+    }
+    ~Graph() {
+        delete[] _first;
+        delete[] _to;
+        delete[] _weight;
+    }
+};
+
+/** Dijkstra with a PriorityQueue, pushing duplicates and skipping stale ones */
+ulong dijkstraLazy(const Graph& g, ulong* dist, ulong& pushes) {
+    for (uint u=0; u<g._n; u++) dist[u] = ~0ul;
+    PriorityQueue<Distance> q;
+    dist[0] = 0;
+    q.push(Distance(0, 0));
+    pushes = 1;
+    while (q.size()) {
+        Distance t = q.top();
+        q.pop();
+        if (t._d > dist[t._node]) {
+            continue;
+        }
+        for (uint e=g._first[t._node]; e<g._first[t._node + 1]; e++) {
+            ulong d = t._d + g._weight[e];
+            if (d < dist[g._to[e]]) {
+                dist[g._to[e]] = d;
+                q.push(Distance(d, g._to[e]));
+                pushes ++;
+            }
+        }
+    }
+    ulong sum = 0;
+    for (uint u=0; u<g._n; u++) sum += dist[u];
+    return sum;
+}
+
+/** Dijkstra with a PairingHeap, updating distances in place */
+ulong dijkstraAddressable(const Graph& g, ulong* dist, ulong& pushes) {
+    typedef PairingHeap<Distance>::Handle Handle;
+    for (uint u=0; u<g._n; u++) dist[u] = ~0ul;
+    Handle* handles = new Handle[g._n];
+    bool* done = new bool[g._n]();
+    PairingHeap<Distance> q;
+    dist[0] = 0;
+    handles[0] = q.push(Distance(0, 0));
+    pushes = 1;
+    while (q.size()) {
+        Distance t = q.top();
+        q.pop();
+        done[t._node] = true;
+        for (uint e=g._first[t._node]; e<g._first[t._node + 1]; e++) {
+            uint v = g._to[e];
+            ulong d = t._d + g._weight[e];
+            if (d < dist[v]) {
+                if (dist[v] == ~0ul) {
+                    handles[v] = q.push(Distance(d, v));
+                    pushes ++;
+                } else if ( ! done[v]) {
+                    q.decrease_key(handles[v], Distance(d, v));
+                }
+                dist[v] = d;
+            }
+        }
+    }
+    delete[] handles;
+    delete[] done;
+    ulong sum = 0;
+    for (uint u=0; u<g._n; u++) sum += dist[u];
+    return sum;
+}
+
+void benchPairingHeap() {
+    cout << "===========\nBENCH_PAIRING_HEAP\n===========\n";
+    const uint n = 1000000, degree = 10;
+    Graph g(n, degree);
+    ulong* dist = new ulong[n];
+    ulong pushes;
+    double start = now();
+    ulong sum = dijkstraLazy(g, dist, pushes);
+    cout << "Dijkstra, " << n << " nodes, " << (ulong)n * degree 
+         << " edges, PriorityQueue with duplicates: " << now() - start 
+         << " s, " << pushes << " pushes (checksum " << sum << ")" << endl;
+    start = now();
+    sum = dijkstraAddressable(g, dist, pushes);
+    cout << "Dijkstra, " << n << " nodes, " << (ulong)n * degree 
+         << " edges, PairingHeap with decrease_key: " << now() - start 
+         << " s, " << pushes << " pushes (checksum " << sum << ")" << endl;
+    delete[] dist;
+}
+
+/** a connection with an idle timeout */
+struct Connection {
+    uint _id;
+    TimerHook _timeout;
+};
+
+/// ticks until an idle connection times out
+const uint TIMEOUT = 30000;
+
+/**
+ * n connections with idle timeouts; during each of 'ticks' ticks, 'active'
+ * random connections see activity, and have their timeouts re-armed
+ * (cancelling the previous ones). Expired connections are re-armed too.
+ */
+double runTimerWheel(uint n, uint ticks, uint active, ulong& expired) {
+    Connection* c = new Connection[n];
+    double elapsed;
+    {
+        // the wheel must go before the connections it links
+        TimerWheel<Connection, &Connection::_timeout> w;
+        uint seed = 2463534242u;
+        double start = now();
+        for (uint i=0; i<n; i++) {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            c[i]._id = i;
+            w.schedule(c[i], 1 + seed % TIMEOUT);
+        }
+        expired = 0;
+        for (uint t=1; t<=ticks; t++) {
+            for (uint i=0; i<active; i++) {
+                seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+                w.schedule(c[seed % n], t + TIMEOUT);
+            }
+            expired += w.advance(t, [&](Connection& e) {
+                w.schedule(e, t + TIMEOUT);
+            });
+        }
+        elapsed = now() - start;
+    }
+    delete[] c;
+    return elapsed;
+}
+
+/** deadline of a connection */
+struct Deadline {
+    ulong _t;
+    uint _id;
+    Deadline() : _t(0), _id(0) {}
+    Deadline(ulong t, uint id) : _t(t), _id(id) {}
+    bool operator<(const Deadline& other) const {
+        return _t < other._t;
+    }
+};
+
+/** same as runTimerWheel, with a PairingHeap */
+double runTimerHeap(uint n, uint ticks, uint active, ulong& expired) {
+    typedef PairingHeap<Deadline>::Handle Handle;
+    Handle* c = new Handle[n];
+    PairingHeap<Deadline> q;
+    uint seed = 2463534242u;
+    double start = now();
+    for (uint i=0; i<n; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        c[i] = q.push(Deadline(1 + seed % TIMEOUT, i));
+    }
+    expired = 0;
+    for (uint t=1; t<=ticks; t++) {
+        for (uint i=0; i<active; i++) {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            uint id = seed % n;
+            q.increase_key(c[id], Deadline(t + TIMEOUT, id));
+        }
+        while (q.top()._t <= t) {
+            q.increase_key(q.topHandle(), Deadline(t + TIMEOUT, q.top()._id));
+            expired ++;
+        }
+    }
+    double elapsed = now() - start;
+    delete[] c;
+    return elapsed;
+}
+
+/** same as runTimerWheel, with a TreeMap keyed by deadline */
+double runTimerTree(uint n, uint ticks, uint active, ulong& expired) {
+    // TreeMap iterates from largest to smallest key: store complements
+    TreeMap<ulong, uint> q;
+    ulong* c = new ulong[n];
+    uint seed = 2463534242u;
+    double start = now();
+    for (uint i=0; i<n; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        c[i] = ~(((ulong)(1 + seed % TIMEOUT) << 24) | i);
+        q.insert(c[i], i);
+    }
+    expired = 0;
+    for (uint t=1; t<=ticks; t++) {
+        for (uint i=0; i<active; i++) {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            uint id = seed % n;
+            q.erase(c[id]);
+            c[id] = ~(((ulong)(t + TIMEOUT) << 24) | id);
+            q.insert(c[id], id);
+        }
+        while ((~q.begin().key() >> 24) <= t) {
+            uint id = q.begin().value();
+            q.erase(c[id]);
+            c[id] = ~(((ulong)(t + TIMEOUT) << 24) | id);
+            q.insert(c[id], id);
+            expired ++;
+        }
+    }
+    double elapsed = now() - start;
+    delete[] c;
+    return elapsed;
+}
+
+void benchTimerWheel() {
+    cout << "===========\nBENCH_TIMER_WHEEL\n===========\n";
+    const uint ticks = 40000, active = 500;
+    ulong expired;
+    for (uint n=1000000; n<=10000000; n*=10) {
+        cout << n << " timers, " << ticks << " ticks, " << (ulong)ticks * active
+             << " re-arms" << endl;
+        double t = runTimerWheel(n, ticks, active, expired);
+        cout << "  TimerWheel: " << t << " s, " << expired << " expired" << endl;
+        t = runTimerHeap(n, ticks, active, expired);
+        cout << "  PairingHeap: " << t << " s, " << expired << " expired" << endl;
+    }
+    // re-arms insert ever-later deadlines, which unbalance the TreeMap
+    // into a list: only a short run is feasible
+    const uint n = 1000000, few = 40;
+    double t = runTimerTree(n, few, active, expired);
+    cout << n << " timers, " << few << " ticks, TreeMap: " << t << " s ("
+         << t / (few * active) * 1e9 << " ns/re-arm)" << endl;
+    t = runTimerWheel(n, few, active, expired);
+    cout << n << " timers, " << few << " ticks, TimerWheel: " << t << " s ("
+         << t / (few * active) * 1e9 << " ns/re-arm, including setup)" << endl;
+}
+
+/**
+ * Fills 'trace' with n keys in [0, keys), drawn from a Zipf distribution
+ * with exponent s: key k is drawn with probability proportional to
+ * 1 / (k+1)^s. Keys are scrambled, so that popular ones are not adjacent.
+ */
+void zipfTrace(uint* trace, uint n, uint keys, double s) {
+    double* cdf = new double[keys];
+    double sum = 0;
+    for (uint k=0; k<keys; k++) {
+        sum += 1 / pow(k + 1.0, s);
+        cdf[k] = sum;
+    }
+    uint seed = 2463534242u;
+    for (uint i=0; i<n; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        double u = (seed / 4294967296.0) * sum;
+        uint lo = 0, hi = keys - 1;
+        while (lo < hi) {
+            uint mid = (lo + hi) / 2;
+            if (cdf[mid] < u) lo = mid + 1; else hi = mid;
+        }
+        trace[i] = lo * 2654435761u;
+    }
+    delete[] cdf;
+}
+
+/** looks up each key in the trace, and puts it in the cache on misses */
+template <class Cache>
+double runTrace(Cache& c, const uint* trace, uint n) {
+    double start = now();
+    for (uint i=0; i<n; i++) {
+        if ( ! c.get(trace[i])) {
+            c.put(trace[i], i);
+        }
+    }
+    return now() - start;
+}
+
+void benchLRUCache() {
+    cout << "===========\nBENCH_LRU_CACHE\n===========\n";
+    const uint n = 20000000, keys = 1000000;
+    uint* trace = new uint[n];
+    double exponents[] = {0.8, 0.99, 1.2};
+    for (uint e=0; e<3; e++) {
+        zipfTrace(trace, n, keys, exponents[e]);
+        for (uint capacity=keys/100; capacity<=keys/10; capacity*=10) {
+            LRUCache<uint, uint> lru(capacity);
+            double t = runTrace(lru, trace, n);
+            cout << "zipf " << exponents[e] << ", capacity " << capacity 
+                 << ": LRU hit rate " << 100.0 * lru.hits() / n << "%, " 
+                 << n / t / 1e6 << " M ops/s" << endl;
+            ClockCache<uint, uint> clock(capacity);
+            t = runTrace(clock, trace, n);
+            cout << "zipf " << exponents[e] << ", capacity " << capacity 
+                 << ": CLOCK hit rate " << 100.0 * clock.hits() / n << "%, " 
+                 << n / t / 1e6 << " M ops/s" << endl;
+        }
+    }
+    delete[] trace;
+}
+
+/** the previous string hash (as in Java's jdk7), which took a copy */
+uint oldStringHash(std::string key) {
+    uint h = 0;
+    for (uint i=0; i<key.length(); i++) {
+        h = 31*h + key[i];
+    }
+    return h;
+}
+
+/** the previous HashTable bin selection, given an old-style hash */
+uint oldBinFor(uint h, uint bins) {
+    h ^= h >> 11;
+    h *= 4294967291u;
+    h ^= h >> 23;
+    return h % bins;
+}
+
+/**
+ * Reports how far bin loads are from those expected of an ideal hash:
+ * the longest chain, and chi-square divided by degrees of freedom
+ * (close to 1 for an ideal hash)
+ */
+void reportBins(const char* label, uint* loads, uint bins, uint keys) {
+    double expected = (double)keys / bins, chi = 0;
+    uint longest = 0;
+    for (uint i=0; i<bins; i++) {
+        chi += (loads[i] - expected) * (loads[i] - expected) / expected;
+        longest = loads[i] > longest ? loads[i] : longest;
+        loads[i] = 0;
+    }
+    cout << "  " << label << ": longest chain " << longest
+         << ", chi2/dof " << chi / (bins - 1) << endl;
+}
+
+/** inserts all names, and looks each up 3 times; returns seconds */
+template <bool CACHE>
+double timeStringTable(Vector<std::string>& names) {
+    double start = now();
+    HashTable<std::string, uint, CACHE> m;
+    for (uint i=0; i<names.size(); i++) m.insert(names.at(i), i);
+    for (uint r=0; r<3; r++) {
+        for (uint i=0; i<names.size(); i++) m.at(names.at(i)) ++;
+    }
+    return now() - start;
+}
+
+void benchHash() {
+    cout << "===========\nBENCH_HASH\n===========\n";
+    uint lengths[] = {8, 32, 256, 4096};
+    for (uint l=0; l<4; l++) {
+        std::string key(lengths[l], 'x');
+        const uint n = 200000000 / lengths[l];
+        ulong sum = 0;
+        double start = now();
+        for (uint i=0; i<n; i++) {
+            key[i % lengths[l]] = (char)i;
+            sum += oldStringHash(key);
+        }
+        double old = now() - start;
+        start = now();
+        for (uint i=0; i<n; i++) {
+            key[i % lengths[l]] = (char)i;
+            sum += ::hash(key);
+        }
+        double fresh = now() - start;
+        cout << "strings of " << lengths[l] << " bytes: jdk7-style " 
+             << (double)n * lengths[l] / old / 1e9 << " GB/s, hash_bytes " 
+             << (double)n * lengths[l] / fresh / 1e9 << " GB/s (checksum " 
+             << sum % 1000 << ")" << endl;
+    }
+    {
+        const uint n = 100000000;
+        ulong sum = 0;
+        double start = now();
+        for (uint i=0; i<n; i++) {
+            sum += ::hash(i);
+        }
+        cout << "integers: " << n / (now() - start) / 1e6 
+             << " M hashes/s (checksum " << sum % 1000 << ")" << endl;
+    }
+    
+    const uint bins = 1 << 16, keys = 1 << 20;
+    uint* loads = new uint[bins]();
+    cout << keys << " keys into " << bins << " bins" << endl;
+    for (uint i=0; i<keys; i++) loads[oldBinFor(i << 12, bins)] ++;
+    reportBins("ints i*2^12, old", loads, bins, keys);
+    for (uint i=0; i<keys; i++) loads[::hash(i << 12) & (bins - 1)] ++;
+    reportBins("ints i*2^12, new", loads, bins, keys);
+    Vector<std::string> names;
+    for (uint i=0; i<keys; i++) names.push_back("user:" + std::to_string(i));
+    for (uint i=0; i<keys; i++) loads[oldBinFor(oldStringHash(names.at(i)), bins)] ++;
+    reportBins("strings user:i, old", loads, bins, keys);
+    for (uint i=0; i<keys; i++) loads[::hash(names.at(i)) & (bins - 1)] ++;
+    reportBins("strings user:i, new", loads, bins, keys);
+    for (uint i=0; i<keys; i++) {
+        names.at(i) = std::string(40, 'a') + std::to_string(i);
+    }
+    for (uint i=0; i<keys; i++) loads[oldBinFor(oldStringHash(names.at(i)), bins)] ++;
+    reportBins("strings of 40 a's + i, old", loads, bins, keys);
+    for (uint i=0; i<keys; i++) loads[::hash(names.at(i)) & (bins - 1)] ++;
+    reportBins("strings of 40 a's + i, new", loads, bins, keys);
+    delete[] loads;
+    
+    // best of two runs each, interleaved, so that neither table gets a
+    // warmer allocator than the other
+    double plain = 1e9, cached = 1e9;
+    for (uint r=0; r<2; r++) {
+        plain = min(plain, timeStringTable<false>(names));
+        cached = min(cached, timeStringTable<true>(names));
+    }
+    cout << keys << " string inserts, 3x lookups; HashTable: " << plain 
+         << " s, with cached hashes: " << cached << " s" << endl;
+}
+
+/** 
+ * Looks up n keys sliced out of buffer (each of them len chars long, 
+ * at a random multiple of stride), through lookup(const char*, uint)
+ */
+template <class Lookup>
+void timeLookups(const char* label, const char* buffer, uint keys, 
+        uint stride, uint len, uint n, const Lookup& lookup) {
+    uint found = 0;
+    ulong x = 1;
+    allocations = 0;
+    countAllocations = true;
+    double start = now();
+    for (uint i=0; i<n; i++) {
+        x = x * 6364136223846793005UL + 1442695040888963407UL;
+        found += lookup(buffer + (x >> 33) % keys * stride, len);
+    }
+    double elapsed = now() - start;
+    countAllocations = false;
+    cout << "  " << label << ": " << elapsed << " s, " << allocations 
+         << " allocations, " << found << " found" << endl;
+}
+
+void benchLookup() {
+    cout << "===========\nBENCH_LOOKUP\n===========\n";
+    // keys as they would arrive in a network buffer: too long for the
+    // small-string optimization, so each std::string allocates
+    const uint keys = 1 << 20, len = 24, stride = len + 1;
+    string buffer;
+    HashTable<string, uint> table;
+    Map<string, uint>::H map;
+    for (uint i=0; i<keys; i++) {
+        char key[len + 2];
+        snprintf(key, sizeof(key), "session:%016lx", (ulong)hash_int(i));
+        table.insert(key, i);
+        map.insert(key, i);
+        buffer += key;
+        buffer += ' ';
+    }
+    const char* b = buffer.c_str();
+    
+    uint n = 10000000;
+    cout << n << " lookups of " << len << "-char keys among " << keys << endl;
+    timeLookups("HashTable, via std::string", b, keys, stride, len, n,
+        [&](const char* p, uint l) { return table.contains(string(p, l)); });
+    timeLookups("HashTable, via StringRef", b, keys, stride, len, n,
+        [&](const char* p, uint l) { return table.contains(StringRef(p, l)); });
+    timeLookups("Map::H, via std::string", b, keys, stride, len, n,
+        [&](const char* p, uint l) { return map.contains(string(p, l)); });
+    timeLookups("Map::H, via StringRef", b, keys, stride, len, n,
+        [&](const char* p, uint l) { return map.contains(StringRef(p, l)); });
+    
+    TreeMap<string, uint> tree;
+    for (uint i=0; i<keys; i++) {
+        tree.insert(string(b + i * stride, len), i);
+    }
+    n = 1000000;
+    cout << n << " lookups in a TreeMap" << endl;
+    timeLookups("TreeMap find, via std::string", b, keys, stride, len, n,
+        [&](const char* p, uint l) { 
+            return tree.find(string(p, l)) != tree.end(); });
+    timeLookups("TreeMap contains, via StringRef", b, keys, stride, len, n,
+        [&](const char* p, uint l) { return tree.contains(StringRef(p, l)); });
+}
+
+/** iterates over all of h, rounds times; returns seconds per round */
+template <class Table>
+double timeIteration(const Table& h, uint rounds, ulong& sum) {
+    double start = now();
+    for (uint r=0; r<rounds; r++) {
+        for (typename Table::Iterator it=h.begin(); it!=h.end(); it.next()) {
+            sum += it.value();
+        }
+    }
+    return (now() - start) / rounds;
+}
+
+void benchHashTableIteration() {
+    cout << "===========\nBENCH_HASHTABLE_ITERATION\n===========\n";
+    const uint n = 1 << 24, kept = 1 << 12;
+    ulong sum = 0;
+    for (uint shrink=0; shrink<2; shrink++) {
+        HashTable<uint, uint> h;
+        h.setShrinkOnErase(shrink);
+        for (uint i=0; i<n; i++) h.insert(i, i);
+        cout << (shrink ? "shrinking on erase: " : "never shrinking: ") << endl;
+        cout << "  full, " << h.size() << " entries in " << h.stats().bins 
+             << " bins: " << timeIteration(h, 3, sum) * 1e3 << " ms per pass" << endl;
+        double start = now();
+        for (uint i=0; i<n; i++) if (i % (n / kept)) h.erase(i);
+        cout << "  erasing all but " << kept << ": " << now() - start << " s" << endl;
+        double t = timeIteration(h, 100, sum);
+        cout << "  sparse, " << h.size() << " entries in " << h.stats().bins 
+             << " bins: " << t * 1e3 << " ms per pass, " << t / kept * 1e9 
+             << " ns per entry" << endl;
+    }
+    cout << "(checksum " << sum % 1000 << ")" << endl;
+}
+
+void benchBulkLoad() {
+    cout << "===========\nBENCH_BULK_LOAD\n===========\n";
+    const uint n = 10000000;
+    const uint threads = TaskPool::global().threads();
+    MapEntry<uint, uint>* entries = new MapEntry<uint, uint>[n];
+    for (uint i=0; i<n; i++) {
+        entries[i] = MapEntry<uint, uint>((uint)hash_int(i), i);
+    }
+    cout << n << " entries, " << thread::hardware_concurrency() 
+         << " hardware threads" << endl;
+    double start = now();
+    {
+        HashTable<uint, uint> h;
+        for (uint i=0; i<n; i++) h.insert(entries[i]._key, entries[i]._value);
+        cout << "  insert(), serial growth: " << now() - start << " s" << endl;
+    }
+    start = now();
+    {
+        ParallelHashTable<uint, uint> h(TaskPool::global(), max(threads, 4u));
+        for (uint i=0; i<n; i++) h.insert(entries[i]._key, entries[i]._value);
+        cout << "  insert(), growing with " << max(threads, 4u) << " threads: " 
+             << now() - start << " s" << endl;
+    }
+    // also beyond the number of cores, to see the cost of splitting
+    for (uint t=1; t<=max(threads, 4u); t*=2) {
+        start = now();
+        ParallelHashTable<uint, uint> h(TaskPool::global(), t);
+        h.bulk_load(entries, entries + n);
+        cout << "  bulk_load(), " << t << " threads: " << now() - start 
+             << " s (" << h.size() << " entries)" << endl;
+    }
+    delete[] entries;
+}
+
+void benchBatchLookup() {
+    cout << "===========\nBENCH_BATCH_LOOKUP\n===========\n";
+    // far larger than any cache: 16M entries in 4M bins
+    const uint n = 1 << 24, lookups = 10000000;
+    MapEntry<ulong, ulong>* entries = new MapEntry<ulong, ulong>[n];
+    for (uint i=0; i<n; i++) {
+        entries[i] = MapEntry<ulong, ulong>(hash_int(i), i);
+    }
+    ulong* keys = new ulong[lookups];
+    for (uint i=0; i<lookups; i++) {
+        // half of them present
+        keys[i] = hash_int(hash_int(i) % (2 * n));
+    }
+    bool* present = new bool[lookups];
+    ulong** values = new ulong*[lookups];
+    uint found = 0;
+    {
+        ParallelHashTable<ulong, ulong> h(TaskPool::global(), 1);
+        h.bulk_load(entries, entries + n);
+        cout << lookups << " random lookups, " << n << " entries in " 
+             << h.stats().bins << " bins" << endl;
+        double start = now();
+        for (uint i=0; i<lookups; i++) found += h.contains(keys[i]);
+        double single = now() - start;
+        start = now();
+        h.contains_batch(keys, lookups, present);
+        double batch = now() - start;
+        for (uint i=0; i<lookups; i++) found += present[i];
+        start = now();
+        h.find_batch(keys, lookups, values);
+        double finds = now() - start;
+        for (uint i=0; i<lookups; i++) found += values[i] != 0;
+        cout << "  HashTable: contains " << single << " s, contains_batch " 
+             << batch << " s (x" << single / batch << "), find_batch " 
+             << finds << " s" << endl;
+    }
+    {
+        // random insertion order keeps the (unbalanced) tree shallow
+        const uint treeSize = 1 << 22, treeLookups = lookups / 5;
+        TreeMap<ulong, ulong> t;
+        for (uint i=0; i<treeSize; i++) {
+            t.insert(entries[i]._key, entries[i]._value);
+        }
+        double start = now();
+        for (uint i=0; i<treeLookups; i++) found += t.contains(keys[i]);
+        double single = now() - start;
+        start = now();
+        t.contains_batch(keys, treeLookups, present);
+        double batch = now() - start;
+        for (uint i=0; i<treeLookups; i++) found += present[i];
+        cout << "  TreeMap, " << treeSize << " entries, " << treeLookups 
+             << " lookups: contains " << single << " s, contains_batch " 
+             << batch << " s (x" << single / batch << ")" << endl;
+    }
+    cout << "(checksum " << found << ")" << endl;
+    delete[] entries;
+    delete[] keys;
+    delete[] present;
+    delete[] values;
+}
+
+/**
+ * Builds a HashTable and a FrozenMap with the n first keys, and looks up
+ * 'lookups' of them (half present), one at a time
+ */
+template <class Key>
+void timeFrozenMap(const char* name, const Key* keys, uint n, uint lookups) {
+    const Key* queries = keys;
+    uint found = 0;
+    double start = now();
+    HashTable<Key, uint> h;
+    for (uint i=0; i<n; i++) h.insert(keys[i], i);
+    double hashBuild = now() - start;
+    start = now();
+    FrozenMap<Key, uint> f(h);
+    double frozenBuild = now() - start;
+    start = now();
+    for (uint i=0; i<lookups; i++) found += h.contains(queries[i % (2 * n)]);
+    double hashLookup = now() - start;
+    start = now();
+    for (uint i=0; i<lookups; i++) found += f.contains(queries[i % (2 * n)]);
+    double frozenLookup = now() - start;
+    cout << n << " " << name << " keys, " << lookups << " lookups (half present)\n"
+         << "  HashTable: build " << hashBuild << " s, lookups " << hashLookup 
+         << " s, " << h.stats().bytes / n << " bytes/entry\n"
+         << "  FrozenMap: build " << frozenBuild << " s (from the HashTable), lookups "
+         << frozenLookup << " s (x" << hashLookup / frozenLookup << "), " 
+         << f.bytes() / n << " bytes/entry" << endl;
+    cout << "(checksum " << found << ")" << endl;
+}
+
+void benchFrozenMap() {
+    cout << "===========\nBENCH_FROZEN_MAP\n===========\n";
+    const uint lookups = 10000000;
+    // keys 0..n-1 present, n..2n-1 missing, all shuffled
+    const uint large = 1 << 22;
+    ulong* keys = new ulong[2 * large];
+    for (uint i=0; i<2 * large; i++) keys[i] = hash_int(i);
+    timeFrozenMap("small int", keys, 1 << 12, lookups);
+    timeFrozenMap("large int", keys, large, lookups);
+    delete[] keys;
+    const uint words = 1 << 20;
+    string* names = new string[2 * words];
+    for (uint i=0; i<2 * words; i++) {
+        names[i] = "/api/v1/route/" + to_string(hash_int(i));
+    }
+    timeFrozenMap("string", names, words, lookups);
+    delete[] names;
+}
+
+void benchMappedHashTable() {
+    cout << "===========\nBENCH_MAPPED_HASHTABLE\n===========\n";
+    const uint n = 1 << 22, lookups = 10000000;
+    const char* path = "bench_mapped_hashtable.bin";
+    ulong* keys = new ulong[lookups];
+    for (uint i=0; i<lookups; i++) {
+        // half of them present
+        keys[i] = hash_int(hash_int(i) % (2 * n));
+    }
+    uint found = 0;
+    double start = now();
+    HashTable<ulong, ulong> h;
+    for (uint i=0; i<n; i++) h.insert(hash_int(i), i);
+    double build = now() - start;
+    start = now();
+    MappedHashTable<ulong, ulong>::write(h, path);
+    double write = now() - start;
+    start = now();
+    MappedHashTable<ulong, ulong> m(path);
+    double open = now() - start;
+    start = now();
+    for (uint i=0; i<lookups; i++) found += m.contains(keys[i]);
+    double first = now() - start;
+    start = now();
+    for (uint i=0; i<lookups; i++) found += m.contains(keys[i]);
+    double mapped = now() - start;
+    start = now();
+    for (uint i=0; i<lookups; i++) found += h.contains(keys[i]);
+    double table = now() - start;
+    cout << n << " entries, " << m.bytes() / (1 << 20) << " MB file, " 
+         << lookups << " lookups (half present)\n"
+         << "  startup: HashTable inserts " << build << " s, MappedHashTable open " 
+         << open << " s (written in " << write << " s)\n"
+         << "  lookups: HashTable " << table << " s, MappedHashTable " << mapped 
+         << " s (" << first << " s while paging in)" << endl;
+    cout << "(checksum " << found << ")" << endl;
+    m.close();
+    remove(path);
+    delete[] keys;
+}
+
+void benchSortedRun() {
+    cout << "===========\nBENCH_SORTED_RUN\n===========\n";
+    const uint n = 1 << 20, lookups = 1000000, scans = 10000;
+    const char* textPath = "bench_sorted_run.txt";
+    const char* runPath = "bench_sorted_run.bin";
+    TreeMap<string, ulong> t;
+    for (uint i=0; i<n; i++) {
+        t.insert("user/" + to_string(hash_int(i) % 10000000000ul), i);
+    }
+    string* keys = new string[lookups];
+    for (uint i=0; i<lookups; i++) {
+        keys[i] = "user/" + to_string(hash_int(i % (2 * n)) % 10000000000ul);
+    }
+    ulong found = 0;
+    
+    // as text, printed with print() and parsed back; printed keys are
+    // sorted, and must be shuffled to keep the TreeMap from degenerating
+    double start = now();
+    {
+        ofstream out(textPath);
+        print(t.begin(), t.end(), out, "\n");
+    }
+    double textSave = now() - start;
+    start = now();
+    {
+        Vector<MapEntry<string, ulong> > parsed;
+        ifstream in(textPath);
+        string line;
+        while (getline(in, line)) {
+            size_t colon = line.find(": ");
+            parsed.push_back(MapEntry<string, ulong>(
+                line.substr(0, colon), strtoul(line.c_str() + colon + 2, 0, 10)));
+        }
+        parsed.shuffle();
+        TreeMap<string, ulong> loaded;
+        for (uint i=0; i<parsed.size(); i++) {
+            loaded.insert(parsed.at(i)._key, parsed.at(i)._value);
+        }
+        found += loaded.size();
+    }
+    double textLoad = now() - start;
+    remove(textPath);
+    
+    start = now();
+    SortedRun<string, ulong>::write(t, runPath, false);
+    double plainSave = now() - start;
+    ulong plainBytes = SortedRun<string, ulong>(runPath).bytes();
+    start = now();
+    SortedRun<string, ulong>::write(t, runPath);
+    double runSave = now() - start;
+    start = now();
+    SortedRun<string, ulong> r(runPath);
+    double runOpen = now() - start;
+    cout << t.size() << " entries; text: save " << textSave << " s, load " << textLoad 
+         << " s\n  SortedRun: save " << runSave << " s, open " << runOpen << " s, "
+         << r.bytes() / 1024 << " KB in " << r.blocks() << " blocks ("
+         << plainBytes / 1024 << " KB, saved in " << plainSave 
+         << " s, without prefix encoding)" << endl;
+    
+    start = now();
+    for (uint i=0; i<lookups; i++) found += t.contains(keys[i]);
+    double treeFind = now() - start;
+    start = now();
+    for (uint i=0; i<lookups; i++) found += r.contains(keys[i]);
+    double runFind = now() - start;
+    // ranges of 100 entries, from random keys
+    ulong sum = 0;
+    uint scanned = 0;
+    start = now();
+    for (uint i=0; i<scans; i++) {
+        SortedRun<string, ulong>::Iterator it = r.lower_bound(keys[i]);
+        for (uint j=0; j<100 && it != r.end(); j++, it.next()) {
+            sum += it.value();
+            scanned ++;
+        }
+    }
+    double runScan = now() - start;
+    cout << "  " << lookups << " lookups (half present): TreeMap " << treeFind 
+         << " s, SortedRun " << runFind << " s\n  " << scans << " range scans: " << scanned 
+         << " entries in " << runScan << " s" << endl;
+    cout << "(checksum " << found + sum << ")" << endl;
+    r.close();
+    remove(runPath);
+    delete[] keys;
+}
+
+/** fills a filter with n keys, and times lookups of absent ones */
+template <class Filter>
+void timeBloomFilter(const char* name, const ulong* keys, uint n, 
+        const ulong* absent, uint lookups, double bitsPerKey) {
+    Filter f(n, bitsPerKey);
+    double start = now();
+    for (uint i=0; i<n; i++) f.insert(keys[i]);
+    double inserts = now() - start;
+    uint positives = 0;
+    start = now();
+    for (uint i=0; i<lookups; i++) positives += f.mayContain(absent[i]);
+    double queries = now() - start;
+    cout << "  " << name << ", " << bitsPerKey << " bits/key, " << f.hashes() 
+         << " hashes: false positives " << 100.0 * positives / lookups << "% (expected " 
+         << 100 * f.falsePositiveRate() << "%), " << inserts * 1e9 / n << " ns/insert, " 
+         << queries * 1e9 / lookups << " ns/lookup" << endl;
+}
+
+/** times lookups in a set, with and without a filter in front */
+template <class SetType>
+void timeBloomFiltered(const char* name, const ulong* keys, uint n, 
+        const ulong* queries, uint lookups) {
+    SetType s;
+    BloomFiltered<ulong, SetType> f(n);
+    for (uint i=0; i<n; i++) {
+        s.insert(keys[i]);
+        f.insert(keys[i]);
+    }
+    uint found = 0;
+    double start = now();
+    for (uint i=0; i<lookups; i++) found += s.contains(queries[i]);
+    double plain = now() - start;
+    start = now();
+    for (uint i=0; i<lookups; i++) found += f.contains(queries[i]);
+    double filtered = now() - start;
+    cout << "  " << name << ", " << n << " keys: contains " << plain 
+         << " s, with a filter " << filtered << " s (x" << plain / filtered 
+         << "; " << f.filtered() << " answered by the filter)" 
+         << " (checksum " << found << ")" << endl;
+}
+
+void benchBloomFilter() {
+    cout << "===========\nBENCH_BLOOM_FILTER\n===========\n";
+    const uint n = 1 << 22, lookups = 10000000;
+    ulong* keys = new ulong[n];
+    for (uint i=0; i<n; i++) keys[i] = hash_int(i);
+    ulong* absent = new ulong[lookups];
+    for (uint i=0; i<lookups; i++) absent[i] = hash_int(n + i);
+    cout << n << " keys, " << lookups << " lookups of absent keys" << endl;
+    const double bits[] = {8, 10, 16};
+    for (uint b=0; b<3; b++) {
+        timeBloomFilter<BloomFilter<ulong> >("BloomFilter", keys, n, absent, lookups, bits[b]);
+        timeBloomFilter<BlockedBloomFilter<ulong> >("BlockedBloomFilter", keys, n, absent, lookups, bits[b]);
+    }
+    
+    // as in deduplication: 9 in 10 lookups are misses
+    ulong* queries = new ulong[lookups];
+    for (uint i=0; i<lookups; i++) {
+        queries[i] = (i % 10 == 0) ? keys[hash_int(i) % n] : absent[i];
+    }
+    cout << lookups << " lookups, 10% present" << endl;
+    timeBloomFiltered<Set<ulong>::H>("Set::H", keys, n, queries, lookups);
+    timeBloomFiltered<Set<ulong>::T>("Set::T", keys, n / 4, queries, lookups / 5);
+    delete[] keys;
+    delete[] absent;
+    delete[] queries;
+}
+
+struct Benchmark {
+    const char* name;
+    void (*run)();
+};
+
+const Benchmark benchmarks[] = {
+    {"spsc", benchSPSCRing},
+    {"mpmc", benchMPMCQueue},
+    {"blocking", benchBlockingQueue},
+    {"stack", benchConcurrentStack},
+    {"tasks", benchTaskPool},
+    {"blockdeque", benchBlockDeque},
+    {"devector", benchDeVector},
+    {"window", benchCVectorWindow},
+    {"slidingwindow", benchSlidingWindow},
+    {"pq", benchPriorityQueue},
+    {"pairing", benchPairingHeap},
+    {"timers", benchTimerWheel},
+    {"cache", benchLRUCache},
+    {"hash", benchHash},
+    {"lookup", benchLookup},
+    {"iterate", benchHashTableIteration},
+    {"bulkload", benchBulkLoad},
+    {"batch", benchBatchLookup},
+    {"frozen", benchFrozenMap},
+    {"mapped", benchMappedHashTable},
+    {"sortedrun", benchSortedRun},
+    {"bloom", benchBloomFilter},
+};
+
+/**
+ * Runs all benchmarks, or only those named on the command line
+ */
+int main(int argc, char* argv[]) {
+    const uint count = sizeof(benchmarks)/sizeof(benchmarks[0]);
+    for (uint i=0; i<count; i++) {
+        bool selected = (argc == 1);
+        for (int j=1; j<argc; j++) {
+            selected = selected || ! strcmp(argv[j], benchmarks[i].name);
+        }
+        if (selected) {
+            benchmarks[i].run();
+        }
+    }
+    return 0;
+}
@@ -1,7 +1,11 @@
+// count HashTable usage, to test its stats; see HashTableStats
+#define EDA_HASHTABLE_STATS
+
 #include <iostream>
 #include <cassert>
 #include <ctime>
 #include <cstdlib>
+#include <thread>
 
 #include "DoubleList.h"
 #include "CVector.h"
@@ -11,6 +15,27 @@
 #include "Map.h"
 #include "Set.h"
 #include "BinTree.h"
+#include "IntrusiveList.h"
+#include "IntrusiveTree.h"
+#include "SPSCRing.h"
+#include "MPMCQueue.h"
+#include "BlockingQueue.h"
+#include "ConcurrentStack.h"
+#include "TaskPool.h"
+#include "ParallelHashTable.h"
+#include "BlockDeque.h"
+#include "DeVector.h"
+#include "SlidingWindow.h"
+#include "PriorityQueue.h"
+#include "PairingHeap.h"
+#include "TimerWheel.h"
+#include "LRUCache.h"
+#include "StringRef.h"
+#include "FrozenMap.h"
+#include "MappedHashTable.h"
+#include "SortedRun.h"
+#include "BloomFilter.h"
+#include "Deque.h"
 
 using namespace std;
 
@@ -91,6 +116,44 @@ void testCVector() {
     print("Sorted", v);
 }
 
+void testCVectorWindow() {
+    cout << "===========\nTEST_CVECTOR_WINDOW\n===========\n";        
+    CVector<int> w(4, FIXED_CAPACITY);
+    assert(w.capacity() == 4 && ! w.full());
+    for (int i=0; i<7; i++) w.push_back(i);
+    assert(w.full() && w.size() == 4 && w.capacity() == 4);
+    assert(w.front() == 3 && w.back() == 6);
+    
+    const int *a, *b;
+    uint na, nb;
+    w.segments(a, na, b, nb);
+    assert(na + nb == 4 && nb > 0);  // wraps around
+    int sum = 0;
+    for (uint i=0; i<na; i++) sum += a[i];
+    for (uint i=0; i<nb; i++) sum += b[i];
+    assert(sum == 3 + 4 + 5 + 6);
+    
+    w.push_front(42);   // drops the back
+    assert(w.size() == 4 && w.front() == 42 && w.back() == 5);
+    CVector<int> c(w), d;
+    d = w;
+    c.push_back(1);
+    d.push_back(1);
+    assert(c.size() == 4 && d.size() == 4 && d.front() == 3 && d.back() == 1);
+    print("Window", d);
+    
+    CVector<int> none(0, FIXED_CAPACITY);
+    none.push_back(1);
+    none.push_front(1);
+    assert(none.size() == 0);
+    try {
+        CVector<int> huge(UINT_MAX, FIXED_CAPACITY);
+        assert(false);
+    } catch (CVectorInvalidCapacity& e) {
+        // expected
+    }
+}
+
 void testListQueue() {
     cout << "===========\nTEST_LQUEUE\n===========\n";    
     Queue<int, SingleList<int> > s, t;
@@ -139,6 +202,1327 @@ void testIterators() {
     print("After", l);
 }
 
+void testSplice() {
+    cout << "===========\nTEST_SPLICE\n===========\n";    
+    DoubleList<int> a, b;
+    for (int i=0; i<5; i++) a.push_back(i);
+    for (int i=10; i<15; i++) b.push_back(i);
+    DoubleList<int>::Iterator first = b.begin();
+    first.next();
+    DoubleList<int>::Iterator last = first;
+    last.next();
+    last.next();
+    DoubleList<int>::Iterator pos = a.begin();
+    pos.next();
+    a.splice(pos, b, first, last);
+    print("After splicing 11, 12 before 1", a);
+    print("Remaining", b);
+    assert(a.size() == 7 && b.size() == 3);
+    assert(a.front() == 0 && a.begin().elem() == 0);
+    assert(first.elem() == 11);
+    
+    // move to front within the same list, as an LRU would
+    DoubleList<int>::Iterator it = a.find(3);
+    DoubleList<int>::Iterator after = it;
+    after.next();
+    a.splice(a.begin(), a, it, after);
+    assert(a.front() == 3 && a.size() == 7);
+    a.splice(a.end(), b, b.begin(), b.end());
+    assert(a.size() == 10 && b.size() == 0 && a.back() == 14);
+    print("After moving 3 to front and appending the rest", a);
+}
+
+void testListSort() {
+    cout << "===========\nTEST_LIST_SORT\n===========\n";    
+    DoubleList<int> d, e;
+    SingleList<int> s, t;
+    srand(1);
+    for (int i=0; i<1000; i++) {
+        int r = rand() % 100;
+        d.push_back(r);
+        s.push_back(r);
+    }
+    d.sort();
+    s.sort();
+    assert(d.size() == 1000 && s.size() == 1000);
+    int prev = -1;
+    for (DoubleList<int>::Iterator it = d.begin(); it != d.end(); it.next()) {
+        assert(prev <= it.elem());
+        prev = it.elem();
+    }
+    assert(prev == d.back());
+    DoubleList<int>::Iterator it = d.begin();
+    for (int i=0; i<999; i++) it.next();
+    assert(&it.elem() == &d.back());
+    for (int i=0; i<999; i++) it.prev(); // prev-links must be intact
+    assert(it == d.begin());
+    SingleList<int>::Iterator jt = s.begin();
+    for (DoubleList<int>::Iterator it = d.begin(); it != d.end(); it.next()) {
+        assert(it.elem() == jt.elem());
+        jt.next();
+    }
+    
+    for (int i=0; i<10; i+=2) e.push_back(i);
+    for (int i=1; i<10; i+=2) t.push_back(i);
+    DoubleList<int> f;
+    for (int i=1; i<10; i+=2) f.push_back(i);
+    e.merge(f);
+    SingleList<int> u;
+    u.merge(t);
+    print("Merged odds and evens", e);
+    assert(e.size() == 10 && f.size() == 0 && e.back() == 9);
+    assert(u.size() == 5 && t.size() == 0 && u.back() == 9);
+}
+
+struct Job {
+    int _deadline;
+    ListHook _queueHook;
+    TreeHook _timerHook;
+    
+    bool operator<(const Job &other) const {
+        return _deadline < other._deadline;
+    }
+};
+
+bool operator<(const Job &j, int deadline) {
+    return j._deadline < deadline;
+}
+
+bool operator<(int deadline, const Job &j) {
+    return deadline < j._deadline;
+}
+
+void testIntrusive() {
+    cout << "===========\nTEST_INTRUSIVE\n===========\n";    
+    const int n = 1000;
+    Job *jobs = new Job[n];
+    IntrusiveList<Job, &Job::_queueHook> l;
+    IntrusiveTree<Job, &Job::_timerHook> t;
+    srand(1);
+    for (int i=0; i<n; i++) {
+        jobs[i]._deadline = rand() % 500;
+        l.push_back(jobs[i]);
+        t.insert(jobs[i]);
+    }
+    assert(l.size() == n && t.size() == n);
+    assert(&l.front() == jobs && &l.back() == jobs + n - 1);
+    
+    // erase every odd job from both, given only a reference to it
+    for (int i=1; i<n; i+=2) {
+        l.erase(jobs[i]);
+        t.erase(jobs[i]);
+    }
+    assert(l.size() == n/2 && t.size() == n/2);
+    assert( ! jobs[1]._queueHook.linked() && jobs[2]._timerHook.linked());
+    int i = 0;
+    for (IntrusiveList<Job, &Job::_queueHook>::Iterator it = l.begin();
+            it != l.end(); it.next(), i+=2) {
+        assert(&it.elem() == jobs + i);
+    }
+    int prev = -1;
+    for (IntrusiveTree<Job, &Job::_timerHook>::Iterator it = t.begin();
+            it != t.end(); it.next()) {
+        assert(prev <= it.elem()._deadline);
+        prev = it.elem()._deadline;
+    }
+    
+    IntrusiveTree<Job, &Job::_timerHook>::Iterator it = t.lower_bound(250);
+    assert(it == t.end() || it.elem()._deadline >= 250);
+    if (t.find(jobs[0]._deadline) == t.end()) {
+        assert(false);
+    }
+    prev = -1;
+    while (t.size()) {
+        assert(prev <= t.front()._deadline);
+        prev = t.front()._deadline;
+        t.pop_front();
+    }
+    cout << "linked and unlinked " << n << " jobs without allocating" << endl;
+    l.clear();
+    delete[] jobs;
+}
+
+void testSPSCRing() {
+    cout << "===========\nTEST_SPSC_RING\n===========\n";    
+    SPSCRing<int> r(5);
+    assert(r.capacity() == 8);
+    int batch[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    assert(r.try_push_n(batch, 10) == 8);
+    assert( ! r.try_push(8));
+    int e;
+    assert(r.try_pop(e) && e == 0);
+    assert(r.try_pop_n(batch, 10) == 7 && batch[6] == 7);
+    assert( ! r.try_pop(e) && r.size() == 0);
+    
+    // one producer, one consumer: elements arrive complete and in order
+    const int n = 1000000;
+    bool inOrder = true;
+    std::thread consumer([&]() {
+        int next = 0, got[64];
+        while (next < n) {
+            uint count = r.try_pop_n(got, 64);
+            if ( ! count) {
+                std::this_thread::yield();
+            }
+            for (uint i=0; i<count; i++) {
+                inOrder = inOrder && (got[i] == next++);
+            }
+        }
+    });
+    for (int i=0; i<n; i++) {
+        while ( ! r.try_push(i)) {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    assert(inOrder && r.size() == 0);
+    cout << n << " elements passed between threads in order" << endl;
+}
+
+void testMPMCQueue() {
+    cout << "===========\nTEST_MPMC_QUEUE\n===========\n";    
+    MPMCQueue<int> q(4);
+    for (int i=0; i<4; i++) assert(q.try_push(i));
+    assert( ! q.try_push(4) && q.size() == 4);
+    int e;
+    for (int i=0; i<4; i++) assert(q.try_pop(e) && e == i);
+    assert( ! q.try_pop(e) && q.size() == 0);
+    
+    // several producers and consumers: nothing is lost or duplicated
+    const int threads = 3, n = 100000;
+    long sums[threads] = {0};
+    std::thread *consumers[threads], *producers[threads];
+    for (int t=0; t<threads; t++) {
+        consumers[t] = new std::thread([&, t]() {
+            int e;
+            for (int i=0; i<n; i++) {
+                q.pop(e);
+                sums[t] += e;
+            }
+        });
+        producers[t] = new std::thread([&, t]() {
+            for (int i=0; i<n; i++) {
+                q.push(t * n + i);
+            }
+        });
+    }
+    long total = 0;
+    for (int t=0; t<threads; t++) {
+        producers[t]->join();
+        consumers[t]->join();
+        delete producers[t];
+        delete consumers[t];
+        total += sums[t];
+    }
+    long count = (long)threads * n;
+    assert(total == count * (count - 1) / 2 && q.size() == 0);
+    cout << count << " elements passed between " << threads 
+         << " producers and " << threads << " consumers" << endl;
+}
+
+void testBlockingQueue() {
+    cout << "===========\nTEST_BLOCKING_QUEUE\n===========\n";    
+    BlockingQueue<int> q(2);
+    int e;
+    assert(q.push(1) && q.push(2));
+    assert( ! q.push_for(3, std::chrono::milliseconds(10)));
+    assert(q.pop(e) && e == 1);
+    assert(q.push_for(3, std::chrono::milliseconds(10)));
+    
+    // a fast producer is held back by the capacity of the queue
+    const int n = 10000;
+    std::thread producer([&]() {
+        for (int i=4; i<n; i++) {
+            q.push(i);
+            assert(q.size() <= q.capacity());
+        }
+        q.close();
+    });
+    int next = 2;
+    Vector<int> batch;
+    while (q.pop_up_to(batch, 16)) {
+        for (uint i=0; i<batch.size(); i++) {
+            assert(batch.at(i) == next++);
+        }
+        while (batch.size()) {
+            batch.pop_back();
+        }
+    }
+    producer.join();
+    assert(next == n && q.closed());
+    assert( ! q.push(0) && ! q.pop(e));
+    assert( ! q.pop_for(e, std::chrono::milliseconds(1)));
+    cout << n << " elements passed through a queue of capacity " 
+         << q.capacity() << endl;
+}
+
+void testConcurrentStack() {
+    cout << "===========\nTEST_CONCURRENT_STACK\n===========\n";    
+    ConcurrentStack<int> s;
+    int e;
+    assert( ! s.pop(e));
+    s.push(1);
+    s.push(2);
+    assert(s.pop(e) && e == 2 && s.size() == 1);
+    assert(s.pop(e) && e == 1 && ! s.pop(e));
+    
+    // stress: threads push and pop concurrently, with many nodes retired
+    const int threads = 4, n = 200000;
+    long popped[threads] = {0};
+    std::thread *workers[threads];
+    for (int t=0; t<threads; t++) {
+        workers[t] = new std::thread([&, t]() {
+            int e;
+            for (int i=0; i<n; i++) {
+                s.push(t * n + i);
+                if (i % 3 != 0 && s.pop(e)) {
+                    popped[t] += e + 1;
+                }
+            }
+        });
+    }
+    long total = 0;
+    for (int t=0; t<threads; t++) {
+        workers[t]->join();
+        delete workers[t];
+        total += popped[t];
+    }
+    while (s.pop(e)) {
+        total += e + 1;
+    }
+    long count = (long)threads * n;
+    assert(total == count * (count + 1) / 2 && s.size() == 0);
+    cout << count << " elements pushed and popped by " << threads 
+         << " threads" << endl;
+}
+
+long parallelFib(TaskPool& pool, int n) {
+    if (n < 15) {
+        return n < 2 ? n : parallelFib(pool, n-1) + parallelFib(pool, n-2);
+    }
+    long a, b;
+    TaskPool::Group g;
+    pool.spawn(g, [&]() { a = parallelFib(pool, n-1); });
+    b = parallelFib(pool, n-2);
+    pool.sync(g);
+    return a + b;
+}
+
+void testTaskPool() {
+    cout << "===========\nTEST_TASK_POOL\n===========\n";    
+    WorkStealingDeque<int> d;
+    int e;
+    for (int i=0; i<100; i++) d.push(i); // forces it to grow
+    assert(d.size() == 100);
+    assert(d.steal(e) && e == 0);
+    assert(d.pop(e) && e == 99);
+    while (d.pop(e));
+    assert( ! d.steal(e) && d.size() == 0);
+    
+    TaskPool pool(3);
+    assert(parallelFib(pool, 25) == 75025);
+    
+    const ulong n = 1000000;
+    std::atomic<ulong> sum(0);
+    pool.parallel_for(0, n, 1000, [&](ulong from, ulong to) {
+        ulong partial = 0;
+        for (ulong i=from; i<to; i++) partial += i;
+        sum += partial;
+    });
+    assert(sum == n * (n-1) / 2);
+    cout << "fib(25) and sum of [0, " << n << ") computed by " 
+         << pool.threads() << " workers" << endl;
+}
+
+void testBlockDeque() {
+    cout << "===========\nTEST_BLOCK_DEQUE\n===========\n";    
+    BlockDeque<int, 4> b;
+    for (int i=0; i<10; i++) b.push_back(i);
+    const int &ref = b.at(5);
+    for (int i=1; i<=10; i++) b.push_front(-i);
+    for (int i=10; i<100; i++) b.push_back(i);  // forces the map to grow
+    assert(&ref == &b.at(15) && ref == 5);  // elements never move
+    assert(b.size() == 110 && b.front() == -10 && b.back() == 99);
+    for (int i=0; i<110; i++) assert(b.at(i) == i - 10);
+    BlockDeque<int, 4> c = b;
+    for (int i=0; i<55; i++) {
+        b.pop_front();
+        b.pop_back();
+    }
+    assert(b.size() == 0 && c.size() == 110);
+    b.push_front(1);
+    assert(b.front() == 1 && b.back() == 1);
+    print("Copy", c);
+    
+    Deque<int, BlockDeque<int> > d;
+    Queue<int, BlockDeque<int> > q;
+    for (int i=0; i<1000; i++) {
+        d.push_front(i);
+        q.push(i);
+    }
+    for (int i=0; i<1000; i++) {
+        assert(d.back() == 0 && d.front() == 999 - i && q.front() == i);
+        q.pop();
+        d.pop_front();
+    }
+    assert(q.size() == 0 && d.size() == 0);
+}
+
+void testDeVector() {
+    cout << "===========\nTEST_DEVECTOR\n===========\n";    
+    DeVector<int> v;
+    for (int i=0; i<100; i++) {
+        v.push_front(-i - 1);
+        v.push_back(i);
+    }
+    assert(v.size() == 200 && v.front() == -100 && v.back() == 99);
+    const int *p = v.data();
+    for (int i=0; i<200; i++) assert(p[i] == i - 100 && v.at(i) == i - 100);
+    DeVector<int> c = v;
+    // a queue that never grows much: re-centers instead of reallocating
+    for (int i=0; i<10000; i++) {
+        v.push_back(i);
+        v.pop_front();
+    }
+    assert(v.size() == 200 && v.front() == 9800 && v.back() == 9999);
+    for (int i=0; i<200; i++) v.pop_back();
+    assert(v.size() == 0);
+    v.push_front(3);
+    v.push_front(7);
+    v.push_back(5);
+    v.sort();
+    assert(v.at(0) == 3 && v.at(1) == 5 && v.at(2) == 7);
+    assert(c.size() == 200 && c.front() == -100);
+    // pushing own elements is safe, even if the buffer moves
+    for (int i=0; i<1000; i++) c.push_front(c.back());
+    assert(c.size() == 1200 && c.front() == 99 && c.at(1000) == -100);
+
+    Deque<int, DeVector<int> > d;
+    for (int i=0; i<1000; i++) d.push_front(i);
+    for (int i=0; i<1000; i++) {
+        assert(d.back() == 0 && d.front() == 999 - i);
+        d.pop_front();
+    }
+}
+
+void testSlidingWindow() {
+    cout << "===========\nTEST_SLIDING_WINDOW\n===========\n";    
+    // count-based: last 100 samples, checked against a rescan
+    SlidingWindowMinMax<int> w(100);
+    CVector<int> last(100, FIXED_CAPACITY);
+    srand(1234);
+    for (int i=0; i<5000; i++) {
+        int v = rand() % 1000 - 500;
+        w.push(v);
+        last.push_back(v);
+        int lo = last.front(), hi = last.front(), sum = 0;
+        for (uint j=0; j<last.size(); j++) {
+            lo = (last.at(j) < lo) ? last.at(j) : lo;
+            hi = (last.at(j) > hi) ? last.at(j) : hi;
+            sum += last.at(j);
+        }
+        assert(w.size() == last.size());
+        assert(w.min() == lo && w.max() == hi && w.sum() == sum);
+    }
+
+    // time-based: last 10 time units
+    SlidingWindowMinMax<double> t(10);
+    t.push(5.0, 100);
+    t.push(1.0, 101);
+    t.push(3.0, 105);
+    assert(t.min() == 1.0 && t.max() == 5.0 && t.size() == 3);
+    t.push(4.0, 110);    // evicts the sample at time 100
+    assert(t.min() == 1.0 && t.max() == 4.0 && t.sum() == 8.0);
+    t.evict(114);
+    assert(t.size() == 2 && t.min() == 3.0 && t.max() == 4.0);
+    t.evict(115);
+    assert(t.size() == 1 && t.min() == 4.0 && t.max() == 4.0);
+    t.evict(120);
+    assert(t.size() == 0 && t.sum() == 0.0);
+    try {
+        t.min();
+        assert(false);
+    } catch (SlidingWindowEmpty& e) {
+        // expected
+    }
+}
+
+struct Later {
+    bool operator()(int a, int b) const {
+        return a > b;
+    }
+};
+
+template <class PQ>
+void checkHeapOrder(PQ& q, uint n) {
+    assert(q.size() == n);
+    int previous = q.top();
+    for (uint i=0; i<n; i++) {
+        assert(q.top() >= previous);
+        previous = q.top();
+        q.pop();
+    }
+    assert(q.size() == 0);
+}
+
+void testPriorityQueue() {
+    cout << "===========\nTEST_PRIORITY_QUEUE\n===========\n";    
+    srand(1234);
+    PriorityQueue<int, Less<int>, 2> q2;
+    PriorityQueue<int> q4;
+    PriorityQueue<int, Less<int>, 8> q8;
+    Vector<int> v;
+    for (int i=0; i<1000; i++) {
+        int r = rand() % 500;
+        q2.push(r);
+        q4.push(r);
+        q8.push(r);
+        v.push_back(r);
+    }
+    checkHeapOrder(q2, 1000);
+    checkHeapOrder(q4, 1000);
+    checkHeapOrder(q8, 1000);
+
+    // heapify from a range, then bulk pushes (large and small)
+    PriorityQueue<int> h(v.begin(), v.end());
+    h.push_n(v.begin(), v.end());
+    for (int i=0; i<10; i++) {
+        Vector<int> few;
+        few.push_back(-i);
+        h.push_n(few.begin(), few.end());
+    }
+    assert(h.top() == -9);
+    checkHeapOrder(h, 2010);
+
+    PriorityQueue<int, Later> m(v.begin(), v.end());
+    v.sort();
+    assert(m.top() == v.back());
+    m.pop();
+    assert(m.size() == 999);
+    try {
+        q4.pop();
+        assert(false);
+    } catch (VectorInvalidIndex& e) {
+        // expected
+    }
+}
+
+void testPairingHeap() {
+    cout << "===========\nTEST_PAIRING_HEAP\n===========\n";    
+    srand(1234);
+    PairingHeap<int> h;
+    const int n = 1000;
+    PairingHeap<int>::Handle handles[n];
+    int values[n];
+    bool erased[n];
+    for (int i=0; i<n; i++) {
+        erased[i] = false;
+        values[i] = rand() % 10000;
+        handles[i] = h.push(values[i]);
+    }
+    // change, raise and erase some of them, through their handles
+    for (int i=0; i<n; i+=3) {
+        values[i] -= 5000;
+        h.decrease_key(handles[i], values[i]);
+    }
+    for (int i=1; i<n; i+=3) {
+        values[i] += 5000;
+        h.increase_key(handles[i], values[i]);
+    }
+    for (int i=2; i<n; i+=30) {
+        h.erase(handles[i]);
+        erased[i] = true;
+    }
+    assert(handles[0].elem() == values[0]);
+    try {
+        h.decrease_key(handles[0], values[0] + 1);
+        assert(false);
+    } catch (PairingHeapInvalidKey& e) {
+        // expected
+    }
+
+    // meld with another heap; its handles remain valid
+    PairingHeap<int> other;
+    PairingHeap<int>::Handle late = other.push(100000);
+    other.push(-100000);
+    h.meld(other);
+    assert(other.size() == 0 && h.top() == -100000);
+    h.pop();
+    h.decrease_key(late, -100000);
+    assert(h.topHandle() == late);
+    h.pop();
+
+    Vector<int> expected;
+    for (int i=0; i<n; i++) {
+        if ( ! erased[i]) expected.push_back(values[i]);
+    }
+    expected.sort();
+    assert(h.size() == expected.size());
+    for (uint i=0; i<expected.size(); i++) {
+        assert(h.top() == expected.at(i));
+        h.pop();
+    }
+    assert(h.size() == 0);
+    try {
+        h.pop();
+        assert(false);
+    } catch (PairingHeapEmpty& e) {
+        // expected
+    }
+
+    // elements left in the heap are freed on destruction
+    for (int i=0; i<n; i++) h.push(i);
+}
+
+struct Timeout {
+    int _id;
+    TimerHook _hook;
+};
+
+void testTimerWheel() {
+    cout << "===========\nTEST_TIMER_WHEEL\n===========\n";    
+    srand(1234);
+    const int n = 10000;
+    Timeout timers[n];
+    TimerWheel<Timeout, &Timeout::_hook> w(1000);
+    for (int i=0; i<n; i++) {
+        timers[i]._id = i;
+        w.schedule(timers[i], 1000 + rand() % (1 << 20));
+    }
+    w.schedule(timers[0], 5);   // already past: expires on next tick
+    int cancelled = 0;
+    for (int i=1; i<n; i+=7) {
+        assert(w.cancel(timers[i]));
+        assert( ! w.cancel(timers[i]));
+        cancelled ++;
+    }
+    for (int i=2; i<n; i+=7) {
+        w.schedule(timers[i], timers[i]._hook.expiry() + 1000); // postpone
+    }
+    assert(w.size() == (uint)(n - cancelled));
+    
+    int expired = 0;
+    ulong last = 0;
+    while (w.size()) {
+        ulong to = w.now() + 1 + rand() % 5000;
+        expired += w.advance(to, [&](Timeout& t) {
+            assert( ! t._hook.scheduled());
+            assert(t._hook.expiry() == w.now() || t._id == 0);
+            assert(w.now() >= last);
+            last = w.now();
+            if (t._id == 3) {
+                w.schedule(t, w.now() + 10);  // rescheduled once
+                t._id = -3;
+            }
+        });
+    }
+    assert(expired == n - cancelled + 1);
+    for (int i=1; i<n; i+=7) assert( ! timers[i]._hook.scheduled());
+    
+    // beyond the range of the top level
+    TimerWheel<Timeout, &Timeout::_hook, 2> small;
+    small.schedule(timers[0], 200000);
+    small.schedule(timers[1], 70000);
+    assert(small.advance(69999, [](Timeout&) { assert(false); }) == 0);
+    assert(small.advance(70000, [](Timeout& t) { assert(t._id == 1); }) == 1);
+    assert(small.advance(199999, [](Timeout&) { assert(false); }) == 0);
+    assert(small.advance(300000, [&](Timeout& t) {
+        assert(t._id == 0 && small.now() == 200000); }) == 1);
+}
+
+template <class Cache>
+void checkCache(Cache& c) {
+    for (int i=0; i<3; i++) c.put(i, i * 10);
+    assert(c.size() == 3 && *c.get(0) == 0 && c.hits() == 1);
+    c.put(3, 30);                 // evicts one entry to make room
+    assert(c.size() == 3 && c.contains(3) && c.contains(0));
+    assert(c.get(42) == 0 && c.misses() == 1);
+    *c.get(3) = 31;
+    assert(*c.get(3) == 31);
+    assert(c.erase(3) && ! c.erase(3) && c.size() == 2);
+    c.put(7, 70, 3);              // takes all the capacity
+    assert(c.size() == 1 && c.weight() == 3 && *c.get(7) == 70);
+    c.put(8, 80, 4);              // too heavy: not cached
+    assert(c.size() == 1 && ! c.contains(8));
+}
+
+void testLRUCache() {
+    cout << "===========\nTEST_LRU_CACHE\n===========\n";    
+    LRUCache<int, int> lru(3);
+    checkCache(lru);
+    ClockCache<int, int> clock(3);
+    checkCache(clock);
+    
+    // LRU evicts exactly the least recently used
+    LRUCache<int, int> c(100);
+    for (int i=0; i<100; i++) c.put(i, i);
+    for (int i=0; i<100; i+=2) c.get(i);
+    for (int i=100; i<150; i++) c.put(i, i);
+    for (int i=0; i<100; i++) assert(c.contains(i) == (i % 2 == 0));
+    
+    // CLOCK keeps recently used entries too, and respects weights
+    ClockCache<string, int> w(1000);
+    for (int i=0; i<1000; i++) {
+        w.put(std::to_string(i), i, 1 + i % 10);
+        w.get("0");
+        assert(w.weight() <= 1000);
+    }
+    assert(w.contains("0") && w.contains("999"));
+}
+
+struct Point {
+    int _x, _y;
+    Point(int x, int y) : _x(x), _y(y) {}
+    bool operator==(const Point& o) const { return _x == o._x && _y == o._y; }
+    uint64_t hash() const {
+        uint64_t h = 0;
+        hash_combine(h, _x);
+        hash_combine(h, _y);
+        return h;
+    }
+};
+
+namespace geo {
+/** a key hashed by a free function, declared after the containers */
+struct Cell {
+    int _row, _column;
+    bool operator==(const Cell& o) const {
+        return _row == o._row && _column == o._column;
+    }
+};
+
+uint64_t hash(const Cell& c) {
+    return hash_mix(c._row ^ EDA_HASH_P0, c._column ^ EDA_HASH_P1);
+}
+}
+
+void testHashFunctions() {
+    cout << "===========\nTEST_HASH_FUNCTIONS\n===========\n";    
+    // byte hashing: every length, and every byte, matters
+    char buffer[200];
+    for (int i=0; i<200; i++) buffer[i] = 'a' + i % 26;
+    HashTable<uint64_t, int> seen;
+    for (int len=0; len<200; len++) {
+        uint64_t h = hash_bytes(buffer, len);
+        assert(seen.find(h) == seen.end());
+        seen.insert(h, len);
+        assert(h == ::hash(string(buffer, len)));
+        buffer[len / 2] ^= 1;
+        assert(hash_bytes(buffer, len) != h || len == 0);
+        buffer[len / 2] ^= 1;
+    }
+    assert(hash_bytes("abc", 3, 1) != hash_bytes("abc", 3, 2));
+    
+    // integers are mixed, but never collide
+    assert(::hash(1) != 1 && ::hash(1u) == ::hash(1ul));
+    assert((::hash(1) ^ ::hash(2)) > 0xffffffffUL);
+    
+    // composite keys: order matters
+    assert(Point(1, 2).hash() != Point(2, 1).hash());
+    HashTable<Point, int> points;
+    for (int i=0; i<100; i++) points.insert(Point(i, -i), i);
+    assert(points.at(Point(42, -42)) == 42 && points.size() == 100);
+    
+    // free hash()es are found by argument-dependent lookup, even on growth
+    HashTable<geo::Cell, int> cells;
+    for (int i=0; i<1000; i++) {
+        geo::Cell c = {i, -i};
+        cells.insert(c, i);
+    }
+    geo::Cell c = {42, -42};
+    assert(cells.at(c) == 42 && cells.size() == 1000);
+    
+    // caching hashes in entries changes nothing but speed
+    HashTable<string, int, true> cached;
+    for (int i=0; i<1000; i++) cached.insert("key" + to_string(i), i);
+    for (int i=0; i<1000; i++) assert(cached.at("key" + to_string(i)) == i);
+    cached.erase("key42");
+    assert(cached.size() == 999 && cached.find("key42") == cached.end());
+}
+
+void testTransparentLookup() {
+    cout << "===========\nTEST_TRANSPARENT_LOOKUP\n===========\n";    
+    // a key sliced out of a larger buffer, which is not '\0'-terminated
+    const char* buffer = "GET user:42 HTTP/1.1";
+    StringRef key(buffer + 4, 7);
+    assert(key == string("user:42") && ! (key < string("user:42")));
+    assert(string("user:4") < key && key < string("user:5"));
+    assert(::hash(key) == ::hash(string("user:42")));
+    assert(::hash("user:42") == ::hash(string("user:42")));
+    
+    HashTable<string, int> h;
+    TreeMap<string, int> t;
+    Map<string, int>::H mh;
+    Map<string, int>::T mt;
+    Set<string>::H sh;
+    Set<string>::T st;
+    for (int i=0; i<100; i++) {
+        string k = "user:" + to_string(i);
+        h.insert(k, i);
+        t.insert(k, i);
+        mh.insert(k, i);
+        mt.insert(k, i);
+        sh.insert(k);
+        st.insert(k);
+    }
+    assert(h.find(key).value() == 42 && h.at(key) == 42 && h.contains(key));
+    assert(t.find(key).value() == 42 && t.at(key) == 42 && t.contains(key));
+    assert(mh.at(key) == 42 && mh.contains(key));
+    assert(mt.at(key) == 42 && mt.contains(key));
+    assert(sh.contains(key) && st.contains(key));
+    
+    
+    // TreeMaps iterate in descending order, also from a found key
+    TreeMap<string, int>::Iterator it = t.find(key);
+    it.next();
+    assert(it.key() == "user:41");
+    
+    // C strings and arrays, too
+    char array[] = "user:7";
+    const char* pointer = "user:99";
+    assert(h.at(array) == 7 && h.at(pointer) == 99);
+    assert(t.at(array) == 7 && t.at(pointer) == 99);
+    h.at(key) = 1042;
+    assert(h.at("user:42") == 1042);
+    
+    StringRef missing(buffer, 3);
+    assert(h.find(missing) == h.end() && ! h.contains(missing));
+    assert(t.find(missing) == t.end() && ! t.contains(missing));
+    assert( ! mh.contains(missing) && ! st.contains("GET"));
+    try {
+        h.at(missing);
+        assert(false);
+    } catch (HashTableNoSuchElement& e) {}
+    try {
+        t.at(missing);
+        assert(false);
+    } catch (TreeMapNoSuchElement& e) {}
+    
+    // cached hashes compare as well
+    HashTable<string, int, true> cached;
+    cached.insert("user:42", 42);
+    assert(cached.at(key) == 42 && ! cached.contains(missing));
+    
+#if __cplusplus >= 201703L
+    std::string_view view(buffer + 4, 7);
+    assert(::hash(view) == ::hash(string("user:42")));
+    assert(h.contains(view) && t.at(view) == 42 && mh.at(view) == 42);
+    assert(sh.contains(view) && st.contains(view));
+#endif
+}
+
+struct BadlyHashedKey {
+    int _k;
+    BadlyHashedKey(int k) : _k(k) {}
+    /** only 4 different hashes */
+    uint64_t hash() const {
+        return _k % 4;
+    }
+    bool operator==(const BadlyHashedKey& other) const {
+        return _k == other._k;
+    }
+};
+
+void testHashTableStats() {
+    cout << "===========\nTEST_HASHTABLE_STATS\n===========\n";
+    HashTable<int, int> h;
+    HashTableStats s = h.stats();
+    assert(s.bins == 16 && s.entries == 0 && s.loadFactor == 0);
+    assert(s.finds == 0 && s.grows == 0 && s.expectedHitProbes == 0);
+    
+    for (int i=0; i<1000; i++) h.insert(i, i);
+    for (int i=0; i<2000; i++) h.contains(i);
+    h.erase(0);
+    s = h.stats();
+    assert(s.entries == 999 && s.inserts == 1000 && s.erases == 1);
+    assert(s.finds == 2000 && s.hits + s.misses == 1000 + 2000 + 1);
+    // inserting a new key is a miss; erasing an existing one, a hit
+    assert(s.hits == 1000 + 1 && s.misses == 1000 + 1000);
+    // grows at 4 entries per bin: 16 -> 32 -> 64 -> 128 -> 256 bins
+    assert(s.grows == 4 && s.bins == 256 && s.growSeconds >= 0);
+    assert(s.loadFactor > 3.8 && s.loadFactor < 4);
+    assert(s.longestChain >= 4 && s.maxHitProbes <= s.longestChain);
+    assert(s.expectedHitProbes > 1 && s.expectedHitProbes < s.longestChain);
+    assert(s.averageHitProbes() >= 1 && s.averageMissProbes() > 0);
+    assert(s.bytes > 999 * sizeof(MapEntry<int, int>));
+    s.print();
+    
+    h.resetStats();
+    s = h.stats();
+    assert(s.finds == 0 && s.hits == 0 && s.grows == 0 && s.entries == 999);
+    
+    // a bad hash is easy to spot
+    HashTable<BadlyHashedKey, int> bad;
+    for (int i=0; i<1000; i++) bad.insert(BadlyHashedKey(i), i);
+    s = bad.stats();
+    assert(s.longestChain == 250 && s.expectedHitProbes > 100);
+    assert(s.maxHitProbes == 0 && s.maxMissProbes == 249);
+}
+
+void testHashTableSparse() {
+    cout << "===========\nTEST_HASHTABLE_SPARSE\n===========\n";
+    HashTable<int, int> h;
+    assert(h.begin() == h.end());
+    for (int i=0; i<100000; i++) h.insert(i, i);
+    for (int i=0; i<100000; i++) if (i % 1000) h.erase(i);
+    // never shrinks by default
+    assert(h.size() == 100 && h.stats().bins == 32768);
+    long sum = 0;
+    uint count = 0;
+    for (HashTable<int, int>::Iterator it=h.begin(); it!=h.end(); it.next()) {
+        assert(it.key() % 1000 == 0 && it.value() == it.key());
+        sum += it.key();
+        count ++;
+    }
+    assert(count == 100 && sum == 1000L * 99 * 100 / 2);
+    
+    // copies keep their bins, and can be iterated too
+    HashTable<int, int> copy(h);
+    count = 0;
+    for (HashTable<int, int>::Iterator it=copy.begin(); it!=copy.end(); it.next()) {
+        count ++;
+    }
+    assert(count == 100 && copy.at(5000) == 5000);
+    
+    // shrinking halves the bins whenever less than half would be used
+    HashTable<int, int> s;
+    s.setShrinkOnErase(true);
+    for (int i=0; i<100000; i++) s.insert(i, i);
+    for (int i=0; i<100000; i++) if (i % 1000) s.erase(i);
+    HashTableStats stats = s.stats();
+    assert(stats.bins == 128 && stats.shrinks == 8 && stats.grows == 11);
+    count = 0;
+    for (HashTable<int, int>::Iterator it=s.begin(); it!=s.end(); it.next()) {
+        count ++;
+    }
+    assert(count == 100 && s.at(99000) == 99000);
+    for (int i=0; i<100; i++) s.erase(i * 1000);
+    assert(s.size() == 0 && s.stats().bins == 16 && s.begin() == s.end());
+}
+
+void testHashTableBulkLoad() {
+    cout << "===========\nTEST_HASHTABLE_BULK_LOAD\n===========\n";
+    const uint n = 200000;
+    MapEntry<uint, uint>* entries = new MapEntry<uint, uint>[n];
+    for (uint i=0; i<n; i++) {
+        // every key appears twice; the second value must win
+        entries[i] = MapEntry<uint, uint>(i % (n / 2), i);
+    }
+    for (uint threads=1; threads<=4; threads*=2) {
+        ParallelHashTable<uint, uint> h(TaskPool::global(), threads);
+        h.insert(7, 0);
+        h.insert(n, n);
+        h.bulk_load(entries, entries + n);
+        assert(h.size() == n / 2 + 1 && h.at(n) == n);
+        for (uint k=0; k<n / 2; k++) {
+            assert(h.at(k) == k + n / 2);
+        }
+        uint count = 0;
+        for (HashTable<uint, uint>::Iterator it=h.begin(); it!=h.end(); it.next()) {
+            count ++;
+        }
+        assert(count == h.size());
+        assert(h.stats().loadFactor < 4 && h.stats().inserts == n + 2);
+    }
+    
+    // loading into an empty table, with cached hashes, from a Vector
+    Vector<MapEntry<string, int> > words;
+    for (int i=0; i<1000; i++) words.push_back(MapEntry<string, int>(to_string(i), i));
+    ParallelHashTable<string, int, true> w(TaskPool::global());
+    w.bulk_load(&words.at(0), &words.at(0) + words.size());
+    assert(w.size() == 1000 && w.at("999") == 999 && ! w.contains("1000"));
+    
+    // growing in parallel, once there are enough bins
+    ParallelHashTable<uint, uint> g(TaskPool::global(), 4);
+    for (uint i=0; i<n; i++) g.insert(i, i);
+    assert(g.size() == n && g.stats().bins == 65536);
+    for (uint i=0; i<n; i++) assert(g.at(i) == i);
+    uint count = 0;
+    for (HashTable<uint, uint>::Iterator it=g.begin(); it!=g.end(); it.next()) {
+        count ++;
+    }
+    assert(count == n);
+    delete[] entries;
+}
+
+void testBatchLookup() {
+    cout << "===========\nTEST_BATCH_LOOKUP\n===========\n";
+    // more keys than a batch, with some missing, and some repeated
+    const uint n = 1000;
+    int keys[n], values[n];
+    for (uint i=0; i<n; i++) {
+        keys[i] = (i * 7) % 600;
+        values[i] = i;
+    }
+    int* found[n];
+    bool present[n];
+    
+    HashTable<int, int> h;
+    TreeMap<int, int> t;
+    h.insert_batch(keys, values, n);
+    t.insert_batch(keys, values, n);
+    assert(h.size() == 600 && t.size() == 600);
+    // the last value for each key wins
+    assert(h.at(0) == 600 && t.at(0) == 600 && h.at(7) == 601 && t.at(7) == 601);
+    
+    int queries[n];
+    for (uint i=0; i<n; i++) queries[i] = (int)i - 200;
+    h.find_batch(queries, n, found);
+    for (uint i=0; i<n; i++) {
+        assert(found[i] ? (queries[i] >= 0 && queries[i] < 600 
+            && *found[i] == h.at(queries[i])) : (queries[i] < 0 || queries[i] >= 600));
+    }
+    t.find_batch(queries, n, found);
+    for (uint i=0; i<n; i++) {
+        assert(found[i] ? *found[i] == t.at(queries[i]) : ! t.contains(queries[i]));
+    }
+    *found[200] = -1;
+    assert(t.at(0) == -1);
+    h.contains_batch(queries, n, present);
+    for (uint i=0; i<n; i++) assert(present[i] == h.contains(queries[i]));
+    t.contains_batch(queries, 5, present);
+    assert( ! present[0] && ! present[4]);
+    t.contains_batch(queries + 200, 1, present);
+    assert(present[0]);
+    
+    // through maps and sets, too
+    Map<int, int>::H mh;
+    Map<int, int>::T mt;
+    Set<int>::H sh;
+    Set<int>::T st;
+    mh.insert_batch(keys, values, n);
+    mt.insert_batch(keys, values, n);
+    sh.insert_batch(keys, n);
+    st.insert_batch(keys, n);
+    assert(mh.size() == 600 && mt.size() == 600 && sh.size() == 600 && st.size() == 600);
+    mh.find_batch(queries, n, found);
+    assert(found[0] == 0 && *found[207] == 601);
+    mt.find_batch(queries, n, found);
+    assert(found[0] == 0 && *found[207] == 601);
+    sh.contains_batch(queries, n, present);
+    assert( ! present[199] && present[200] && present[799] && ! present[800]);
+    st.contains_batch(queries, n, present);
+    assert( ! present[199] && present[200] && present[799] && ! present[800]);
+    mh.contains_batch(queries, 0, present);
+    
+    // with strings, and cached hashes
+    string names[3] = {"ana", "bea", "eva"};
+    HashTable<string, int, true> c;
+    c.insert("bea", 2);
+    c.contains_batch(names, 3, present);
+    assert( ! present[0] && present[1] && ! present[2]);
+}
+
+void testFrozenMap() {
+    cout << "===========\nTEST_FROZEN_MAP\n===========\n";
+    HashTable<int, int> h;
+    for (int i=0; i<10000; i++) {
+        h.insert(i * 3, i);
+    }
+    FrozenMap<int, int> f(h);
+    assert(f.size() == h.size());
+    for (int i=-10; i<30010; i++) {
+        assert(f.contains(i) == h.contains(i));
+        if (f.contains(i)) assert(f.at(i) == h.at(i) && f.find(i).value() == i / 3);
+    }
+    assert(f.find(1) == f.end());
+    bool thrown = false;
+    try { f.at(1); } catch (FrozenMapNoSuchElement&) { thrown = true; }
+    assert(thrown);
+    // each entry is in one slot, and iteration visits them all
+    long sum = 0;
+    uint count = 0;
+    for (FrozenMap<int, int>::Iterator it = f.begin(); it != f.end(); it.next()) {
+        assert(h.at(it.key()) == it.value());
+        sum += it.value();
+        count ++;
+    }
+    assert(count == 10000 && sum == 9999L * 10000 / 2);
+    
+    // from maps, from ranges; copies, and empty maps
+    Map<string, int>::H words;
+    words.insert("ana", 1);
+    words.insert("bea", 2);
+    words.insert("eva", 3);
+    FrozenMap<string, int> fw(words);
+    assert(fw.size() == 3 && fw.at("bea") == 2 && ! fw.contains("zoe"));
+    assert(fw.at(StringRef("eva")) == 3);
+    TreeMap<string, int> t;
+    t.insert("x", 9);
+    t.insert("y", 10);
+    FrozenMap<string, int> ft(t.begin(), t.end());
+    assert(ft.size() == 2 && ft.at("y") == 10);
+    FrozenMap<string, int> copy(ft);
+    ft = fw;
+    assert(copy.at("x") == 9 && ft.at("ana") == 1 && ! ft.contains("x"));
+    FrozenMap<string, int> empty((HashTable<string, int>()));
+    assert(empty.size() == 0 && ! empty.contains("ana") && empty.begin() == empty.end());
+    cout << "frozen: " << f.bytes() << " bytes vs " << h.stats().bytes << " in a HashTable\n";
+}
+
+void testMappedHashTable() {
+    cout << "===========\nTEST_MAPPED_HASHTABLE\n===========\n";
+    const char* path = "test_mapped_hashtable.bin";
+    HashTable<int, double> h;
+    for (int i=0; i<5000; i++) {
+        h.insert(i * 7, i / 2.0);
+    }
+    MappedHashTable<int, double>::write(h, path);
+    MappedHashTable<int, double> m(path);
+    assert(m.size() == h.size());
+    for (int i=-10; i<35010; i++) {
+        assert(m.contains(i) == h.contains(i));
+        if (m.contains(i)) assert(m.at(i) == h.at(i) && m.find(i).value() == h.at(i));
+    }
+    bool thrown = false;
+    try { m.at(1); } catch (MappedHashTableNoSuchElement&) { thrown = true; }
+    assert(thrown);
+    uint count = 0;
+    for (MappedHashTable<int, double>::Iterator it = m.begin(); it != m.end(); it.next()) {
+        assert(h.at(it.key()) == it.value());
+        count ++;
+    }
+    assert(count == 5000);
+    
+    // rewriting a mapped file leaves the mapping as it was, until reopened
+    Map<int, double>::H small;
+    small.insert(1, 1.5);
+    MappedHashTable<int, double>::write(small, path);
+    assert(m.size() == 5000 && m.at(7) == 0.5);
+    m.open(path);
+    assert(m.size() == 1 && m.at(1) == 1.5 && ! m.contains(7));
+    
+    // other types, empty files, and files that are not tables
+    thrown = false;
+    try { MappedHashTable<long, double> other(path); } 
+    catch (MappedHashTableBadFile&) { thrown = true; }
+    assert(thrown);
+    
+    // corrupt bin offsets: the last is checked on open, others on lookup
+    MappedHashTable<int, double>::write(h, path);
+    FILE* f = fopen(path, "r+b");
+    MappedHashTableHeader header;
+    size_t read = fread(&header, sizeof(header), 1, f);
+    assert(read == 1);
+    uint32_t bad = 0xfffffff0;
+    fseek(f, header.binsOffset + header.bins * sizeof(uint32_t), SEEK_SET);
+    fwrite(&bad, sizeof(bad), 1, f);
+    fclose(f);
+    thrown = false;
+    try { m.open(path); } catch (MappedHashTableBadFile&) { thrown = true; }
+    assert(thrown && m.size() == 0);
+    MappedHashTable<int, double>::write(h, path);
+    f = fopen(path, "r+b");
+    for (uint i=1; i<header.bins; i++) {
+        fseek(f, header.binsOffset + i * sizeof(uint32_t), SEEK_SET);
+        fwrite(&bad, sizeof(bad), 1, f);
+    }
+    fclose(f);
+    m.open(path);
+    thrown = false;
+    try { m.contains(7); } catch (MappedHashTableBadFile&) { thrown = true; }
+    assert(thrown);
+    
+    MappedHashTable<int, double>::write(HashTable<int, double>(), path);
+    m.open(path);
+    assert(m.size() == 0 && ! m.contains(0) && m.begin() == m.end());
+    f = fopen(path, "w");
+    fputs("not a table, but long enough to have a header's size", f);
+    fclose(f);
+    thrown = false;
+    try { m.open(path); } catch (MappedHashTableBadFile&) { thrown = true; }
+    assert(thrown && m.size() == 0);
+    remove(path);
+    thrown = false;
+    try { m.open(path); } catch (MappedHashTableIOError&) { thrown = true; }
+    assert(thrown);
+}
+
+/** to count and sum what SortedRun::scan visits */
+struct ScanTotal {
+    int* total;
+    void operator()(const string& key, int value) {
+        *total += value;
+    }
+};
+
+void testSortedRun() {
+    cout << "===========\nTEST_SORTED_RUN\n===========\n";
+    const char* path = "test_sorted_run.bin";
+    // keys with long shared prefixes, in random order
+    TreeMap<string, int> t;
+    for (int i=0; i<3000; i++) {
+        int k = (i * 1237) % 3000;
+        t.insert("user/" + to_string(1000000 + k * 2), k);
+    }
+    SortedRun<string, int>::write(t, path, true, 256);
+    SortedRun<string, int> r(path);
+    assert(r.size() == 3000 && r.blocks() > 10);
+    
+    // in increasing order, unlike the TreeMap
+    uint count = 0;
+    string last;
+    for (SortedRun<string, int>::Iterator it = r.begin(); it != r.end(); it.next()) {
+        assert(count == 0 || last < it.key());
+        assert(t.at(it.key()) == it.value());
+        last = it.key();
+        count ++;
+    }
+    assert(count == 3000);
+    for (int k=0; k<3000; k++) {
+        string present = "user/" + to_string(1000000 + k * 2);
+        string missing = "user/" + to_string(1000000 + k * 2 + 1);
+        assert(r.contains(present) && r.at(present) == k && r.find(present).value() == k);
+        assert( ! r.contains(missing) && r.find(missing) == r.end());
+        SortedRun<string, int>::Iterator it = r.lower_bound(missing);
+        assert(k == 2999 ? it == r.end() : it.value() == k + 1);
+    }
+    assert(r.lower_bound("a").key() == "user/1000000" && r.lower_bound("z") == r.end());
+    bool thrown = false;
+    try { r.at("nobody"); } catch (SortedRunNoSuchElement&) { thrown = true; }
+    assert(thrown);
+    
+    // range scans: [10, 20) holds 10 + ... + 19
+    int total = 0;
+    ScanTotal visit = { &total };
+    assert(r.scan("user/1000020", "user/1000040", visit) == 10 && total == 145);
+    assert(r.scan("user/1000041", "user/1000041", visit) == 0);
+    
+    // without prefix encoding, files are larger, but read the same
+    ulong prefixed = r.bytes();
+    SortedRun<string, int>::write(t, path, false, 256);
+    r.open(path);
+    assert(r.bytes() > prefixed && r.size() == 3000 && r.at("user/1000100") == 50);
+    
+    // streaming writers, other types, empty runs, and errors
+    {
+        SortedRunWriter<int, double> w(path);
+        w.add(1, 0.5);
+        w.add(5, 2.5);
+        thrown = false;
+        try { w.add(3, 1.5); } catch (SortedRunUnsorted&) { thrown = true; }
+        assert(thrown);
+        w.finish();
+    }
+    SortedRun<int, double> numbers(path);
+    assert(numbers.size() == 2 && numbers.at(5) == 2.5 && numbers.lower_bound(2).key() == 5);
+    {
+        SortedRunWriter<int, double> w(path);
+        w.finish();
+    }
+    numbers.open(path);
+    assert(numbers.size() == 0 && numbers.begin() == numbers.end() && ! numbers.contains(1));
+    {
+        // not finished: discarded
+        SortedRunWriter<int, double> w("test_sorted_run_unfinished.bin");
+        w.add(1, 1);
+    }
+    thrown = false;
+    try { numbers.open("test_sorted_run_unfinished.bin"); } 
+    catch (SortedRunIOError&) { thrown = true; }
+    assert(thrown);
+    FILE* f = fopen(path, "w");
+    fputs("not a run, but long enough to have a header's size", f);
+    fclose(f);
+    thrown = false;
+    try { numbers.open(path); } catch (SortedRunBadFile&) { thrown = true; }
+    assert(thrown);
+    
+    // corrupt index offsets: the first and last are checked on open,
+    // others on lookup
+    uint64_t bad = 1ULL << 40;
+    for (int target=0; target<3; target++) {
+        {
+            SortedRunWriter<int, double> w(path, true, 64);
+            for (int i=0; i<1000; i++) w.add(i, i);
+            w.finish();
+        }
+        f = fopen(path, "r+b");
+        SortedRunHeader header;
+        size_t read = fread(&header, sizeof(header), 1, f);
+        assert(read == 1 && header.blocks > 10);
+        // first block start; or all other block starts, or key starts
+        uint64_t from = target == 0 ? 0 : 1;
+        uint64_t to = target == 0 ? 1 : header.blocks;
+        uint64_t array = target == 2 ? header.blocks + 1 : 0;
+        for (uint64_t i=from; i<to; i++) {
+            fseek(f, header.indexOffset + (array + i) * 8, SEEK_SET);
+            fwrite(&bad, sizeof(bad), 1, f);
+        }
+        fclose(f);
+        thrown = false;
+        try {
+            numbers.open(path);
+            numbers.contains(3);
+            numbers.contains(997);
+        } catch (SortedRunBadFile&) { thrown = true; }
+        assert(thrown);
+    }
+    remove(path);
+}
+
+/** inserts 0, 2, 4... into a filter, and counts false positives among odd keys */
+template <class Filter>
+double bloomFalsePositives(Filter& f, int n) {
+    for (int i=0; i<n; i++) {
+        f.insert(i * 2);
+    }
+    int positives = 0;
+    for (int i=0; i<n; i++) {
+        assert(f.mayContain(i * 2));
+        positives += f.mayContain(i * 2 + 1);
+    }
+    return (double)positives / n;
+}
+
+void testBloomFilter() {
+    cout << "===========\nTEST_BLOOM_FILTER\n===========\n";
+    const int n = 100000;
+    BloomFilter<int> plain(n);
+    BlockedBloomFilter<int> blocked(n);
+    double p1 = bloomFalsePositives(plain, n);
+    double p2 = bloomFalsePositives(blocked, n);
+    cout << "false positives, 10 bits/key: " << p1 << " (expected " 
+         << plain.falsePositiveRate() << "), blocked " << p2 << endl;
+    assert(plain.size() == n && plain.hashes() == 7 && p1 < 0.015 && p2 < 0.025);
+    // more bits, fewer false positives
+    BloomFilter<int> large(n, 16);
+    BlockedBloomFilter<int> blockedLarge(n, 16);
+    assert(bloomFalsePositives(large, n) < p1 / 4 && bloomFalsePositives(blockedLarge, n) < p2 / 4);
+    // copies are independent
+    BlockedBloomFilter<int> copy(blocked);
+    blocked.clear();
+    assert(blocked.size() == 0 && ! blocked.mayContain(0) && copy.mayContain(0));
+    plain = BloomFilter<int>(10);
+    assert( ! plain.mayContain(0) && plain.bits() == 128);
+    blocked = copy;
+    assert(blocked.size() == n && blocked.mayContain(0));
+    
+    BloomFilter<string> names(100);
+    names.insert("ana");
+    assert(names.mayContain("ana") && names.mayContain(StringRef("ana")));
+    
+    // in front of sets and maps, even as they outgrow their filters
+    BloomFiltered<int, Set<int>::H> s(16);
+    BloomFiltered<int, Set<int>::T, BloomFilter<int> > t(16);
+    BloomFiltered<string, Map<string, int>::H> m(16);
+    for (int i=0; i<1000; i++) {
+        s.insert(i * 3);
+        t.insert(i * 3);
+        m.insert(to_string(i), i);
+    }
+    assert(s.size() == 1000 && t.size() == 1000 && m.size() == 1000);
+    for (int i=0; i<3000; i++) {
+        assert(s.contains(i) == (i % 3 == 0) && t.contains(i) == (i % 3 == 0));
+    }
+    assert(s.filtered() > 1500 && s.filter().size() == 1000);
+    s.erase(3);
+    assert( ! s.contains(3) && s.contains(6) && s.size() == 999);
+    s.rebuild();
+    assert(s.filter().size() == 999 && ! s.contains(3) && s.contains(6));
+    assert(m.contains("999") && ! m.contains("1000") && m.container().at("7") == 7);
+}
+
 void testHash() {
     cout << "===========\nTEST_HASH\n===========\n";    
     HashTable<int, int> m;
@@ -370,10 +1754,36 @@ void testTreeDiagnostic() {
 
 int main() {
     testCVector();    
+    testCVectorWindow();
     testVectorStack();
     testListStack();
     testUtils();
     testIterators();
+    testSplice();
+    testListSort();
+    testIntrusive();
+    testSPSCRing();
+    testMPMCQueue();
+    testBlockingQueue();
+    testConcurrentStack();
+    testTaskPool();
+    testBlockDeque();
+    testDeVector();
+    testSlidingWindow();
+    testPriorityQueue();
+    testPairingHeap();
+    testTimerWheel();
+    testLRUCache();
+    testHashFunctions();
+    testTransparentLookup();
+    testHashTableStats();
+    testHashTableSparse();
+    testHashTableBulkLoad();
+    testBatchLookup();
+    testFrozenMap();
+    testMappedHashTable();
+    testSortedRun();
+    testBloomFilter();
     
     testTree();
     
@@ -7,6 +7,8 @@
 #include "Map.h"
 #include "Set.h"
 #include "BinTree.h"
+#include "BlockDeque.h"
+#include "DeVector.h"
 
 #include "bandit/bandit.h"
 #include <vector>
@@ -103,6 +105,14 @@ go_bandit([](){
             DoubleList<int> d;
             test_linear(d, o);
         });
+        describe("block-deque:", [&](){
+            BlockDeque<int, 4> b;
+            test_linear(b, o);
+        });
+        describe("devector:", [&](){
+            DeVector<int> d;
+            test_linear(d, o);
+        });
     });
 });
 